@@ -0,0 +1,114 @@
+/*
+ * Throughput of LineScanner against a memchr newline count, which is the bar any line indexer has
+ * to clear, on synthetic source-like text with some multi-byte UTF-8 and DOS line endings.
+ *
+ * usage: pico-bench-linescanner [megabytes]
+ */
+
+#include "util/LineScanner.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+using namespace pico;
+
+namespace {
+
+constexpr int rounds = 10;
+
+std::string
+generate(size_t size)
+{
+    static const char *const words[] = {
+        "int", "return", "const", "std::string", "for", "while",
+        "{",   "}",      "pico",  "naïve",       "日本語", "😀",
+    };
+    std::mt19937 rng(42);
+    std::string text;
+    text.reserve(size + 128);
+    while (text.size() < size) {
+        const int indent = rng() % 4;
+        text.append(indent * 4, ' ');
+        const int count = rng() % 12;
+        for (int i = 0; i < count; i++) {
+            text += words[rng() % (sizeof(words) / sizeof(*words))];
+            text += ' ';
+        }
+        text += rng() % 16 == 0 ? "\r\n" : "\n";
+    }
+    text.resize(size);
+    return text;
+}
+
+template<typename F>
+double
+measure(const std::string &text, size_t *sink, F &&f)
+{
+    double best = 0;
+    for (int r = 0; r < rounds; r++) {
+        const auto start = std::chrono::steady_clock::now();
+        *sink += f(text.data(), text.size());
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const double gbps = text.size() / elapsed.count() / 1e9;
+        if (gbps > best)
+            best = gbps;
+    }
+    return best;
+}
+
+size_t
+memchrNewlines(const char *data, size_t size)
+{
+    size_t count = 0;
+    const char *end = data + size;
+    for (const char *p = data; (p = static_cast<const char *>(std::memchr(p, '\n', end - p))); p++)
+        count++;
+    return count;
+}
+
+} // namespace
+
+int
+main(int argc, char **argv)
+{
+    const size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    const std::string text = generate(megabytes << 20);
+    size_t sink = 0;
+
+    const size_t expected = memchrNewlines(text.data(), text.size());
+    std::printf("%zu MiB, %zu lines, dispatching to %s\n", megabytes, expected,
+                LineScanner::name(LineScanner::isa()));
+    std::printf("%-8s %8.2f GB/s  (newlines only)\n", "memchr",
+                measure(text, &sink, memchrNewlines));
+
+    using Isa = LineScanner::Isa;
+    const Isa isas[] = { Isa::Scalar, Isa::Sse2, Isa::Avx2 };
+    const LineScanner::Result reference = LineScanner::scan(Isa::Scalar, text.data(), text.size());
+    for (Isa isa : isas) {
+        if (!LineScanner::supports(isa))
+            continue;
+        const LineScanner::Result result = LineScanner::scan(isa, text.data(), text.size());
+        if (result.newlines != reference.newlines || result.crlf != reference.crlf ||
+            result.codepoints != reference.codepoints ||
+            result.supplementary != reference.supplementary) {
+            std::fprintf(stderr, "%s disagrees with the scalar scanner\n", LineScanner::name(isa));
+            return 1;
+        }
+        const double gbps = measure(text, &sink, [isa](const char *data, size_t size) {
+            return LineScanner::scan(isa, data, size).newlines;
+        });
+        std::printf("%-8s %8.2f GB/s  (newlines, crlf, codepoints)\n", LineScanner::name(isa),
+                    gbps);
+    }
+
+    const double nth = measure(text, &sink, [&](const char *data, size_t size) {
+        return LineScanner::findNthNewline(data, size, expected);
+    });
+    std::printf("%-8s %8.2f GB/s  (findNthNewline)\n", "nth", nth);
+
+    return sink == 0;
+}
@@ -0,0 +1,219 @@
+/*
+ * Throughput of SimpleTerminal::twrite against feeding the same bytes to tputc one code point
+ * at a time, as twrite did before it wrote runs of printable ASCII in bulk. Both have to leave
+ * identical screens behind. Random mixes of escape sequences are also checked against the
+ * screens the switch based parser left before the VT500 state machine replaced it.
+ *
+ * usage: pico-bench-terminal [megabytes]
+ */
+
+#include "st.h"
+
+#include <QCoreApplication>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+namespace {
+
+constexpr int chunk = 64 * 1024;
+constexpr int columns = 160;
+constexpr int rows = 50;
+
+/* screens the switch based parser left for the mixes of each seed, 2 MiB each */
+constexpr struct {
+    unsigned seed;
+    uint64_t screen;
+} parserScreens[] = {
+    { 1, 0x089808f21ba9b59c }, { 2, 0x4d40fd9435a582ca }, { 3, 0x9b71048927d083e3 },
+    { 4, 0x3eea3d3ea5daa435 }, { 5, 0xb7a1af901665548c },
+};
+
+SimpleTerminal *
+terminal()
+{
+    /* never deleted, the benchmark only runs once */
+    SimpleTerminal *st = new SimpleTerminal();
+    st->sel = {};
+    st->sel.ob.x = -1;
+    st->tresize(columns, rows);
+    return st;
+}
+
+std::string
+plain(size_t size)
+{
+    static const char words[] = "the quick brown fox jumps over the lazy dog 0123456789 ";
+    std::string text;
+    text.reserve(size + 256);
+    for (int i = 0; text.size() < size; i++) {
+        if (i % 8 == 0)
+            text += "\033[1;32m";
+        text += words;
+        text += words;
+        if (i % 8 == 0)
+            text += "\033[0m";
+        text += "\r\n";
+    }
+    return text;
+}
+
+/* long lines that wrap, wide characters, insert and autowrap toggled on the way */
+std::string
+wrapping(size_t size)
+{
+    static const char words[] = "the quick brown fox jumps over the lazy dog 0123456789 ";
+    std::string text;
+    text.reserve(size + 256);
+    for (int i = 0; text.size() < size; i++) {
+        text += words;
+        if (i % 5 == 0)
+            text += "\xc3\xa4\xe4\xb8\xad x";
+        if (i % 7 == 0)
+            text += "\033[4h";
+        if (i % 7 == 3)
+            text += "\033[4l\033[?7l";
+        if (i % 7 == 5)
+            text += "\033[?7h\033[5D";
+    }
+    return text;
+}
+
+std::string
+mixed(size_t size, unsigned seed)
+{
+    static const char *const sequences[] = {
+        "\033[1;31m", "\033[0m", "\033[38;5;208m", "\033[48;2;10;20;30m", "\033[H",
+        "\033[2J", "\033[K", "\033[5;10H", "\033[3A", "\033[2B", "\033[10C", "\033[4D",
+        "\033[?25l", "\033[?25h", "\033[?7l", "\033[?7h", "\033[4h", "\033[4l",
+        "\033]0;title\007", "\033]2;other title\033\\", "\033(0lqqk\033(B", "\033[2L",
+        "\033[3M", "\033[5P", "\033[2@", "\033[3X", "\033[5;20r", "\033[r", "\033M", "\033D",
+        "\033E", "\0337", "\0338", "\033[s", "\033[u", "\r\n", "\n", "\t", "\b",
+        "\033[1;4;7m", "\033[22;24;27m", "\033[?1049h", "\033[?1049l",
+        "\033[10;5f", "\033[?6h", "\033[?6l", "\xc3\xa4\xc3\xb6", "\xe4\xb8\xad\xe6\x96\x87",
+        "\033#8", "\033[S", "\033[T", "\033P1$r\033\\", "\033[3g", "\033H", "\033[Z",
+        "\033[2I", "\033[38;2;1;2;3;48;5;17m", "\033[;H", "\033[0;0;0m", "\030", "\032",
+    };
+    std::mt19937 rng(seed);
+    std::string text;
+    text.reserve(size + 256);
+    while (text.size() < size) {
+        if (rng() % 3)
+            text += sequences[rng() % (sizeof(sequences) / sizeof(*sequences))];
+        const int letters = rng() % 6;
+        for (int i = 0; i < letters; i++)
+            text += "lorem ipsum "[rng() % 12];
+        text += "word ";
+    }
+    return text;
+}
+
+/* feeds text in chunks the way ttyread does, returns MB/s */
+template<typename F>
+double
+feed(SimpleTerminal &st, const std::string &text, F &&write)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t off = 0; off < text.size();) {
+        const int n = write(st, text.data() + off, std::min<size_t>(chunk, text.size() - off));
+        if (n == 0)
+            break;
+        off += n;
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return text.size() / elapsed.count() / 1e6;
+}
+
+double
+fast(SimpleTerminal &st, const std::string &text)
+{
+    return feed(st, text, [](SimpleTerminal &st, const char *buf, int size) {
+        return st.twrite(buf, size, 0);
+    });
+}
+
+double
+slow(SimpleTerminal &st, const std::string &text)
+{
+    return feed(st, text, [](SimpleTerminal &st, const char *buf, int size) {
+        return st.twritechars(buf, size);
+    });
+}
+
+uint64_t
+screen(const SimpleTerminal &st)
+{
+    /* FNV-1a over the glyphs, the cursor and the modes */
+    uint64_t hash = 0xcbf29ce484222325;
+    auto mix = [&hash](uint64_t v) {
+        hash = (hash ^ v) * 0x100000001b3;
+    };
+    for (int y = 0; y < st.term.row; y++) {
+        for (int x = 0; x < st.term.col; x++) {
+            const Glyph &g = st.term.line[y][x];
+            mix(g.u);
+            mix(g.mode);
+            mix(g.fg);
+            mix(g.bg);
+        }
+    }
+    mix(st.term.c.x);
+    mix(st.term.c.y);
+    mix(st.term.mode);
+    mix(st.term.charset);
+    return hash;
+}
+
+} // namespace
+
+int
+main(int argc, char **argv)
+{
+    /* the pty needs a child, one that exits right away writes nothing to the screen */
+    qputenv("SHELL", "/bin/true");
+    QCoreApplication app(argc, argv);
+    const size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+    int failed = 0;
+
+    const struct {
+        const char *name;
+        std::string text;
+    } workloads[] = {
+        { "plain", plain(megabytes << 20) },
+        { "wrapping", wrapping(megabytes << 20) },
+        { "mixed", mixed(megabytes << 20, 42) },
+    };
+    std::printf("%zu MiB per workload, %dx%d screen\n", megabytes, columns, rows);
+    for (const auto &workload : workloads) {
+        SimpleTerminal &reference = *terminal();
+        SimpleTerminal &st = *terminal();
+        const double before = slow(reference, workload.text);
+        const double after = fast(st, workload.text);
+        const bool same = screen(reference) == screen(st);
+        std::printf("%-8s %8.1f MB/s per character %8.1f MB/s twrite  %s\n", workload.name,
+                    before, after, same ? "same screen" : "SCREENS DIFFER");
+        failed |= !same;
+    }
+
+    bool parity = true;
+    for (const auto &expected : parserScreens) {
+        SimpleTerminal &st = *terminal();
+        fast(st, mixed(2 << 20, expected.seed));
+        const uint64_t hash = screen(st);
+        if (hash != expected.screen) {
+            std::printf("seed %u: screen %016llx, the switch based parser left %016llx\n",
+                        expected.seed, (unsigned long long) hash,
+                        (unsigned long long) expected.screen);
+            parity = false;
+        }
+    }
+    if (parity)
+        std::printf("all mixes leave the screens the switch based parser left\n");
+    failed |= !parity;
+
+    return failed;
+}
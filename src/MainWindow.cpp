@@ -24,13 +24,18 @@ MainWindow::MainWindow(QMainWindow *parent)
     editor->addBinding({ Qt::SHIFT | Qt::Key_Colon }, Mode::Normal, [=]() {
         editor->setMode(Mode::Command);
     });
+    editor->addBinding({ Qt::Key_Slash }, Mode::Normal, [=]() {
+        commandPrompt->setPrefix("/");
+        editor->setMode(Mode::Command);
+    });
 
     connect(editor, &Editor::modeChange, [=](Mode mode) {
         if (mode == Mode::Command) {
             commandPromptDock->show();
             commandPrompt->setFocus();
-        } else {
+        } else if (commandPromptDock->isVisible()) {
             commandPromptDock->hide();
+            editor->currentBuffer()->currentEditor()->setFocus();
         }
     });
 
@@ -2,28 +2,47 @@
 #include "editor/FileTree.hpp"
 
 #include <QApplication>
+#include <QDebug>
+#include <QFileSystemModel>
 
 namespace pico {
 
 Buffer::Buffer(QWidget *parent)
     : QWidget(parent),
-      m_layout(new QHBoxLayout(this)),
+      m_layout(new QVBoxLayout(this)),
       m_splitter(new QSplitter(this)),
-      m_fileTree(new FileTree(m_splitter))
+      m_fileTree(new FileTree(m_splitter)),
+      m_progress(new QProgressBar(this)),
+      m_textEdit(nullptr),
+      m_hexEdit(nullptr)
 {
     m_layout->setSpacing(0);
     m_layout->setContentsMargins(0, 0, 0, 0);
     m_layout->addWidget(m_splitter);
+    m_layout->addWidget(m_progress);
     m_splitter->setHandleWidth(0);
 
-    auto *textEdit = new TextEdit(this);
-    m_splitter->addWidget(textEdit);
-    textEdit->setFocus();
+    m_progress->setTextVisible(false);
+    m_progress->setMaximumHeight(4);
+    m_progress->setRange(0, 1000);
+    m_progress->hide();
 
-    m_fileTree->setFont(parent->font());
-    textEdit->setFont(parent->font());
-    connect(m_fileTree, &FileTree::clicked, [=]() {
+    m_textEdit = new TextEdit(this);
+    m_splitter->addWidget(m_textEdit);
+    m_textEdit->setFocus();
 
+    m_fileTree->setFont(parent->font());
+    m_textEdit->setFont(parent->font());
+    /* remember the text edit last focused so commands act on it once the prompt has focus */
+    connect(qApp, &QApplication::focusChanged, this, [=](QWidget *, QWidget *now) {
+        auto *textEdit = qobject_cast<TextEdit *>(now);
+        if (textEdit && isAncestorOf(textEdit))
+            m_textEdit = textEdit;
+    });
+    connect(m_fileTree, &FileTree::clicked, [=](const QModelIndex &index) {
+        auto *fs = static_cast<QFileSystemModel *>(m_fileTree->model());
+        if (!fs->isDir(index) && openFile(fs->filePath(index)))
+            currentTextEdit()->setFocus();
     });
 }
 
@@ -46,7 +65,7 @@ Buffer::splitLeft(QWidget *widget)
         m_splitter->setHandleWidth(0);
         m_splitter->addWidget(widget);
         m_splitter->addWidget(oldSplitter);
-        m_layout->addWidget(m_splitter);
+        m_layout->insertWidget(0, m_splitter);
 
     } else {
         auto *parentSplitter = (QSplitter *)oldWidget->parent();
@@ -94,7 +113,7 @@ Buffer::splitBottom(QWidget *widget)
         m_splitter->setHandleWidth(0);
         m_splitter->addWidget(oldSplitter);
         m_splitter->addWidget(widget);
-        m_layout->addWidget(m_splitter);
+        m_layout->insertWidget(0, m_splitter);
 
     } else {
         auto *parentSplitter = (QSplitter *)oldWidget->parent();
@@ -151,4 +170,85 @@ Buffer::toggleFileTree(void)
     }
 }
 
+TextEdit *
+Buffer::currentTextEdit(void)
+{
+    return m_textEdit;
+}
+
+bool
+Buffer::openFile(const QString &path)
+{
+    auto *textEdit = currentTextEdit();
+    connect(textEdit, &TextEdit::loadProgress, this, &Buffer::setProgress, Qt::UniqueConnection);
+    return textEdit->openFile(path);
+}
+
+bool
+Buffer::openHex(const QString &path)
+{
+    if (m_hexEdit && !closeHex())
+        return false;
+    auto *hexEdit = new HexEdit(this);
+    if (!hexEdit->openFile(path)) {
+        delete hexEdit;
+        return false;
+    }
+
+    /* the text edit is only hidden, it keeps its document for when the hex edit is closed */
+    auto *splitter = static_cast<QSplitter *>(m_textEdit->parentWidget());
+    splitter->insertWidget(splitter->indexOf(m_textEdit), hexEdit);
+    m_textEdit->hide();
+    m_hexEdit = hexEdit;
+    m_hexEdit->setFocus();
+    return true;
+}
+
+bool
+Buffer::closeHex(void)
+{
+    if (m_hexEdit == nullptr)
+        return true;
+    if (m_hexEdit->isModified()) {
+        qWarning() << "unsaved bytes in" << m_hexEdit->filePath();
+        return false;
+    }
+
+    /* the text edit it replaced follows it in the splitter */
+    auto *splitter = static_cast<QSplitter *>(m_hexEdit->parentWidget());
+    QWidget *replaced = splitter->widget(splitter->indexOf(m_hexEdit) + 1);
+    delete m_hexEdit;
+    m_hexEdit = nullptr;
+    if (replaced) {
+        replaced->show();
+        replaced->setFocus();
+    }
+    return true;
+}
+
+HexEdit *
+Buffer::hexEdit(void)
+{
+    return m_hexEdit;
+}
+
+QWidget *
+Buffer::currentEditor(void)
+{
+    if (m_hexEdit)
+        return m_hexEdit;
+    return m_textEdit;
+}
+
+void
+Buffer::setProgress(qint64 done, qint64 total)
+{
+    if (total <= 0 || done >= total) {
+        m_progress->hide();
+        return;
+    }
+    m_progress->setValue(static_cast<int>(done * 1000 / total));
+    m_progress->show();
+}
+
 } // namespace pico
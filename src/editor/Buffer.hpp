@@ -1,10 +1,12 @@
 #pragma once
 
 #include <QBoxLayout>
+#include <QProgressBar>
 #include <QSplitter>
 #include <QTreeView>
 #include <QWidget>
 
+#include <editor/HexEdit.hpp>
 #include <editor/TextEdit.hpp>
 
 namespace pico {
@@ -46,10 +48,39 @@ public:
     void
     toggleFileTree(void);
 
+    TextEdit *
+    currentTextEdit(void);
+
+    bool
+    openFile(const QString &path);
+
+    /* show path in a hex edit in place of the current text edit, refused over unsaved bytes */
+    bool
+    openHex(const QString &path);
+
+    /* put the text edit back, false if the hex edit has unsaved bytes */
+    bool
+    closeHex(void);
+
+    /* the hex edit shown, nullptr if there is none */
+    HexEdit *
+    hexEdit(void);
+
+    /* the hex edit while one is shown, the current text edit otherwise */
+    QWidget *
+    currentEditor(void);
+
+    void
+    setProgress(qint64 done, qint64 total);
+
 private:
     QBoxLayout *m_layout;
     QSplitter *m_splitter;
     QTreeView *m_fileTree;
+    QProgressBar *m_progress;
+    /* last focused text edit of this buffer */
+    TextEdit *m_textEdit;
+    HexEdit *m_hexEdit;
 };
 
 } // namespace pico
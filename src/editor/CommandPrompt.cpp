@@ -11,11 +11,23 @@ CommandPrompt::CommandPrompt(QWidget *parent)
     : QPlainTextEdit(parent),
       PicoWidget(this),
       m_previousCommands({}),
-      m_index(0)
+      m_index(0),
+      m_prefix(":"),
+      m_searchOrigin(0)
 {
     setMaximumHeight(32);
     appendPlainText(":");
     m_previousCommands.push_front(":");
+
+    /* leaving a search without Enter puts the cursor back where it was */
+    connect(Editor::getInstance(), &Editor::modeChange, this, [=](Mode mode) {
+        if (mode == Mode::Command || m_prefix != "/")
+            return;
+        auto *textEdit = Editor::getInstance()->currentBuffer()->currentTextEdit();
+        textEdit->search({}, 0);
+        textEdit->setCursorPosition(m_searchOrigin);
+        setPrefix(":");
+    });
 }
 
 void
@@ -30,14 +42,25 @@ CommandPrompt::keyPressEvent(QKeyEvent *event)
     m_previousCommands[m_index] = toPlainText();
     auto key = event->key();
 
-    if (key == Key_Backspace && toPlainText() == ":") {
+    if (key == Key_Backspace && toPlainText() == m_prefix) {
         return;
+    } else if (m_prefix == "/") {
+        if (key == Key_Enter || key == Key_Return) {
+            /* the search already ran while typing */
+            setPrefix(":");
+            editor->setMode(Mode::Normal);
+            return;
+        }
+        /* every keystroke starts over, cancelling the search for the previous pattern */
+        QPlainTextEdit::keyPressEvent(event);
+        auto *textEdit = editor->currentBuffer()->currentTextEdit();
+        textEdit->search(toPlainText().sliced(1), m_searchOrigin);
     } else if (key == Key_Enter || key == Key_Return) {
         auto command = toPlainText();
         if (command.count() >= 2 && command[1] == '!') {
             executeCommand(command.sliced(2));
         } else {
-            qWarning() << "internal commands not yet supported";
+            executeInternalCommand(command.sliced(1));
         }
         setPlainText("");
         appendPlainText(":");
@@ -61,6 +84,61 @@ CommandPrompt::keyPressEvent(QKeyEvent *event)
     }
 }
 
+void
+CommandPrompt::executeInternalCommand(const QString &cmd)
+{
+    auto *buffer = Editor::getInstance()->currentBuffer();
+    auto *textEdit = buffer->currentTextEdit();
+
+    const QString command = cmd.trimmed().section(' ', 0, 0);
+    const QString argument = cmd.trimmed().section(' ', 1).trimmed();
+
+    bool isNumber;
+    const qulonglong line = command.toULongLong(&isNumber);
+    if (isNumber) {
+        /* lines are 1-based on the command line */
+        textEdit->gotoLine(line > 0 ? line - 1 : 0);
+    } else if (command == "w" && buffer->hexEdit()) {
+        /* bytes are written back in place, a hex edit has nowhere else to save to */
+        if (!argument.isEmpty())
+            qWarning() << "a hex edit only saves to" << buffer->hexEdit()->filePath();
+        else
+            buffer->hexEdit()->save();
+    } else if (command == "w") {
+        textEdit->save(argument);
+    } else if (command == "hex") {
+        /* :hex toggles the hex edit of the file being edited, :hex path opens path in one */
+        if (argument.isEmpty() && buffer->hexEdit())
+            buffer->closeHex();
+        else
+            buffer->openHex(argument.isEmpty() ? textEdit->filePath() : argument);
+    } else if (command == "grep") {
+        Editor::getInstance()->grep(argument);
+    } else if (command == "glyphs") {
+        const GlyphCache &glyphs = textEdit->view().glyphCache();
+        qInfo().noquote() << QString("glyph cache: %1 hits, %2 misses, %3 of %4 KiB")
+                                 .arg(glyphs.hits())
+                                 .arg(glyphs.misses())
+                                 .arg(glyphs.memory() / 1024)
+                                 .arg(glyphs.capacity() / 1024);
+    } else {
+        qWarning() << "unknown command" << cmd;
+    }
+}
+
+void
+CommandPrompt::setPrefix(const QString &prefix)
+{
+    if (prefix == "/") {
+        auto *textEdit = Editor::getInstance()->currentBuffer()->currentTextEdit();
+        m_searchOrigin = textEdit->cursorPosition();
+    }
+    m_prefix = prefix;
+    m_index = 0;
+    setPlainText("");
+    appendPlainText(prefix);
+}
+
 void
 CommandPrompt::executeCommand(const QString &cmd)
 {
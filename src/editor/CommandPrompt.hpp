@@ -19,9 +19,19 @@ public:
     void
     executeCommand(const QString &cmd);
 
+    void
+    executeInternalCommand(const QString &cmd);
+
+    /* ":" for commands, "/" to search the current TextEdit as the pattern is typed */
+    void
+    setPrefix(const QString &prefix);
+
 private:
     QList<QString> m_previousCommands;
     int m_index;
+    QString m_prefix;
+    /* cursor of the TextEdit being searched when the search prompt opened */
+    size_t m_searchOrigin;
 };
 
 } // namespace pico
@@ -1,5 +1,7 @@
 #include "Editor.hpp"
 #include <QApplication>
+#include <QDebug>
+#include <QDir>
 #include <QStackedLayout>
 #include <QTextEdit>
 #include <QTreeView>
@@ -57,6 +59,20 @@ Editor::mode(void)
     return m_mode;
 }
 
+Editor::Register &
+Editor::yankRegister(void)
+{
+    return m_register;
+}
+
+WordIndex &
+Editor::wordIndex(void)
+{
+    /* outlives the editor, its buffers take their words back out as they are destroyed */
+    static WordIndex index;
+    return index;
+}
+
 void
 Editor::setMode(Mode mode)
 {
@@ -82,7 +98,7 @@ Editor::nextBuffer(void)
     auto i = m_stack->currentIndex() + 1;
     if (i >= m_stack->count())
         i = 0;
-    m_stack->setCurrentIndex(i);
+    nthBuffer(i);
 }
 
 void
@@ -91,21 +107,47 @@ Editor::prevBuffer(void)
     auto i = m_stack->currentIndex() - 1;
     if (i < 0)
         i = m_stack->count() - 1;
-    m_stack->setCurrentIndex(i);
+    nthBuffer(i);
 }
 
 void
 Editor::nthBuffer(int index)
 {
-    if (index < 0 || index >= m_stack->count())
+    if (index < 0 || index >= m_stack->count() || index == m_stack->currentIndex())
         return;
+    /* loads go on in hidden buffers, only closing or reopening the file cancels them */
     m_stack->setCurrentIndex(index);
 }
 
+void
+Editor::grep(const QString &pattern)
+{
+    if (pattern.isEmpty())
+        return;
+
+    /* buffers are only ever appended, the index stays valid */
+    const int origin = m_stack->currentIndex();
+    auto *buffer = new Buffer(this);
+    m_stack->addWidget(buffer);
+    nthBuffer(m_stack->indexOf(buffer));
+
+    auto *results = buffer->currentTextEdit();
+    connect(results, &TextEdit::resultActivated, this,
+            [=](const QString &path, size_t line, size_t column) {
+                nthBuffer(origin);
+                if (currentBuffer()->openFile(path))
+                    currentBuffer()->currentTextEdit()->gotoLine(line, column);
+                currentBuffer()->currentTextEdit()->setFocus();
+            });
+    results->grep(pattern, QDir::currentPath());
+    results->setFocus();
+}
+
 Editor::Editor(QMainWindow *parent)
     : QWidget(parent),
       m_modifiers({}),
       m_mode(Mode::Normal),
+      m_register(),
       m_keyFilter(nullptr),
       m_stack(new QStackedLayout(this))
 {
@@ -144,6 +186,11 @@ Editor::Init(void)
     addBinding({ Key_Space, Key_O }, Mode::Normal, [=]() {
         currentBuffer()->showFileTree();
     });
+
+    connect(this, &Editor::saved, [](const QString &path, bool ok, const QString &error) {
+        if (!ok)
+            qWarning() << "saving" << path << "failed:" << error;
+    });
 }
 
 } // namespace pico
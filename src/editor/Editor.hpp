@@ -5,8 +5,11 @@
 #include <QStackedLayout>
 #include <QWidget>
 
+#include <string>
+
 #include "editor/Buffer.hpp"
 #include "editor/KeyFilter.hpp"
+#include "editor/WordIndex.hpp"
 #include "util/Util.hpp"
 
 namespace pico {
@@ -18,6 +21,14 @@ class Editor final : public QWidget
 {
     Q_OBJECT
 
+public: /* types */
+    /* text last yanked or deleted, put with p and P in any buffer */
+    struct Register {
+        std::string text;
+        /* whole lines, the text ending in a newline */
+        bool linewise = false;
+    };
+
 public: /* functions */
     static Editor *
     getInstance(QMainWindow *parent = nullptr);
@@ -40,6 +51,13 @@ public: /* functions */
     Mode
     mode(void);
 
+    Register &
+    yankRegister(void);
+
+    /* identifiers of every open buffer, for completion */
+    static WordIndex &
+    wordIndex(void);
+
     void
     setMode(Mode mode);
 
@@ -58,10 +76,21 @@ public: /* functions */
     void
     nthBuffer(int index);
 
+    /*
+     * search the files below the current directory for pattern, listing the matches in a new
+     * buffer from which Enter opens a match in the buffer grep was started from
+     */
+    void
+    grep(const QString &pattern);
+
 signals:
     void
     modeChange(Mode mode);
 
+    /* emitted on the UI thread once a background save has been committed or has failed */
+    void
+    saved(const QString &path, bool ok, const QString &error);
+
 private: /* vars */
     struct {
         unsigned shift : 2;
@@ -69,6 +98,7 @@ private: /* vars */
         unsigned alt : 2;
     } m_modifiers;
     Mode m_mode;
+    Register m_register;
     KeyFilter *m_keyFilter;
     QStackedLayout *m_stack;
 
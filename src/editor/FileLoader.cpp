@@ -0,0 +1,94 @@
+#include "FileLoader.hpp"
+
+#include <QFile>
+#include <QStringDecoder>
+
+namespace pico {
+
+FileLoader::FileLoader(const QString &path, QObject *parent)
+    : QObject(parent),
+      m_path(path),
+      m_thread(nullptr),
+      m_cancelled(false),
+      m_encoding()
+{
+    qRegisterMetaType<pico::TextMetrics>();
+}
+
+FileLoader::~FileLoader()
+{
+    cancel();
+    if (m_thread)
+        m_thread->wait();
+}
+
+void
+FileLoader::start(void)
+{
+    Q_ASSERT(m_thread == nullptr);
+    m_thread = QThread::create([this]() {
+        run();
+    });
+    m_thread->setParent(this);
+    m_thread->start(QThread::LowPriority);
+}
+
+void
+FileLoader::cancel(void)
+{
+    m_cancelled = true;
+}
+
+const QString &
+FileLoader::path(void) const
+{
+    return m_path;
+}
+
+std::optional<QStringConverter::Encoding>
+FileLoader::encoding(void) const
+{
+    return m_encoding;
+}
+
+void
+FileLoader::run(void)
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit finished(false, file.errorString());
+        return;
+    }
+    const qint64 total = file.size();
+
+    /* UTF-8 is passed through as is, a BOM selects a decoder for UTF-16/32 files */
+    std::optional<QStringDecoder> decoder;
+    const auto encoding = QStringDecoder::encodingForData(file.peek(4));
+    m_encoding = encoding;
+    if (encoding == QStringDecoder::Utf8)
+        file.skip(3);
+    else if (encoding)
+        decoder.emplace(*encoding);
+
+    qint64 loaded = file.pos();
+    while (!m_cancelled) {
+        const QByteArray raw = file.read(PieceTree::chunkSize);
+        if (raw.isEmpty())
+            break;
+        loaded += raw.size();
+
+        const QByteArray chunk = decoder ? QString(decoder->decode(raw)).toUtf8() : raw;
+        const std::string_view text(chunk.constData(), chunk.size());
+        emit chunkLoaded(chunk, TextMetrics::measure(text));
+        emit progress(loaded, total);
+    }
+
+    if (m_cancelled)
+        emit finished(false, "cancelled");
+    else if (file.error() != QFile::NoError)
+        emit finished(false, file.errorString());
+    else
+        emit finished(true, {});
+}
+
+} // namespace pico
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QStringConverter>
+#include <QThread>
+
+#include <atomic>
+#include <optional>
+
+#include "editor/PieceTree.hpp"
+
+Q_DECLARE_METATYPE(pico::TextMetrics)
+
+namespace pico {
+
+/**
+ * Reads and decodes a file on a worker thread, publishing it chunk by chunk as UTF-8 so a view can
+ * render the first screen before the rest of the file has arrived
+ */
+class FileLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileLoader(const QString &path, QObject *parent = nullptr);
+
+    ~FileLoader();
+
+    void
+    start(void);
+
+    /* stop reading, chunks already queued may still be delivered */
+    void
+    cancel(void);
+
+    const QString &
+    path(void) const;
+
+    /* encoding named by the byte order mark, none for UTF-8 without one, valid once finished */
+    std::optional<QStringConverter::Encoding>
+    encoding(void) const;
+
+signals:
+    /* a chunk of UTF-8 text of at most about PieceTree::chunkSize bytes, measured off-thread */
+    void
+    chunkLoaded(const QByteArray &chunk, const pico::TextMetrics &metrics);
+
+    void
+    progress(qint64 loaded, qint64 total);
+
+    void
+    finished(bool ok, const QString &error);
+
+private:
+    void
+    run(void);
+
+private:
+    QString m_path;
+    QThread *m_thread;
+    std::atomic<bool> m_cancelled;
+    std::optional<QStringConverter::Encoding> m_encoding;
+};
+
+} // namespace pico
@@ -0,0 +1,120 @@
+#include "FileSaver.hpp"
+
+#include <QSaveFile>
+#include <QStringDecoder>
+#include <QStringEncoder>
+
+namespace pico {
+
+static size_t
+textSize(const PieceTable::Snapshot &snapshot)
+{
+    size_t size = 0;
+    for (const Piece &piece : snapshot.pieces)
+        size += piece.length;
+    return size;
+}
+
+FileSaver::FileSaver(const QString &path, PieceTable::Snapshot snapshot,
+                     std::optional<QStringConverter::Encoding> encoding, QObject *parent)
+    : QObject(parent),
+      m_path(path),
+      m_snapshot(std::move(snapshot)),
+      m_encoding(encoding),
+      m_thread(nullptr),
+      m_cancelled(false),
+      m_fingerprint(textSize(m_snapshot))
+{}
+
+FileSaver::~FileSaver()
+{
+    cancel();
+    if (m_thread)
+        m_thread->wait();
+}
+
+void
+FileSaver::start(void)
+{
+    Q_ASSERT(m_thread == nullptr);
+    m_thread = QThread::create([this]() {
+        run();
+    });
+    m_thread->setParent(this);
+    m_thread->start();
+}
+
+void
+FileSaver::cancel(void)
+{
+    m_cancelled = true;
+}
+
+void
+FileSaver::wait(void)
+{
+    if (m_thread)
+        m_thread->wait();
+}
+
+const QString &
+FileSaver::path(void) const
+{
+    return m_path;
+}
+
+QByteArray
+FileSaver::hash(void) const
+{
+    return m_fingerprint.result();
+}
+
+void
+FileSaver::run(void)
+{
+    /* QSaveFile writes to a temporary file and on commit flushes, syncs and renames it */
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        emit finished(m_path, false, file.errorString());
+        return;
+    }
+
+    /* pieces may split a character, the decoder carries it over to the next one */
+    std::optional<QStringDecoder> decoder;
+    std::optional<QStringEncoder> encoder;
+    if (m_encoding) {
+        decoder.emplace(QStringConverter::Utf8);
+        encoder.emplace(*m_encoding, QStringConverter::Flag::WriteBom);
+    }
+
+    for (const Piece &piece : m_snapshot.pieces) {
+        if (m_cancelled) {
+            file.cancelWriting();
+            break;
+        }
+        const std::string_view text = m_snapshot.view(piece);
+        QByteArray encoded;
+        if (encoder) {
+            const QString decoded = decoder->decode(QByteArrayView(text.data(), text.size()));
+            encoded = encoder->encode(decoded);
+        }
+        const QByteArrayView bytes =
+            encoder ? QByteArrayView(encoded) : QByteArrayView(text.data(), text.size());
+        if (file.write(bytes.data(), bytes.size()) != bytes.size())
+            break;
+        /* hashed on the way out, the undo history identifies saved states by it */
+        m_fingerprint.addData(text);
+    }
+
+    if (m_cancelled) {
+        emit finished(m_path, false, "cancelled");
+        return;
+    }
+    if (!file.commit()) {
+        emit finished(m_path, false, file.errorString());
+        return;
+    }
+    emit finished(m_path, true, {});
+}
+
+} // namespace pico
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QStringConverter>
+#include <QThread>
+
+#include <atomic>
+#include <optional>
+
+#include "editor/Fingerprint.hpp"
+#include "editor/PieceTable.hpp"
+
+namespace pico {
+
+/**
+ * Writes a document snapshot on a worker thread to a temporary file next to the target, which is
+ * synced and then atomically renamed over it, the target is never left half written
+ *
+ * The document is UTF-8. Given the encoding of a byte order mark the file was opened with, the
+ * text is converted back to it and the mark written first.
+ */
+class FileSaver : public QObject
+{
+    Q_OBJECT
+
+public:
+    FileSaver(const QString &path, PieceTable::Snapshot snapshot,
+              std::optional<QStringConverter::Encoding> encoding = std::nullopt,
+              QObject *parent = nullptr);
+
+    ~FileSaver();
+
+    void
+    start(void);
+
+    /* abandon the save, the temporary file is discarded and the target left untouched */
+    void
+    cancel(void);
+
+    /* block until the worker is done, finished is still delivered through the event loop */
+    void
+    wait(void);
+
+    const QString &
+    path(void) const;
+
+    /* Fingerprint of the text written, valid once finished has been emitted */
+    QByteArray
+    hash(void) const;
+
+signals:
+    void
+    finished(const QString &path, bool ok, const QString &error);
+
+private:
+    void
+    run(void);
+
+private:
+    QString m_path;
+    PieceTable::Snapshot m_snapshot;
+    std::optional<QStringConverter::Encoding> m_encoding;
+    QThread *m_thread;
+    std::atomic<bool> m_cancelled;
+    Fingerprint m_fingerprint;
+};
+
+} // namespace pico
@@ -42,6 +42,8 @@ FileTree::keyPressEvent(QKeyEvent *event)
     case Key_K:
         return setCurrentIndex(indexAbove(currentIndex()));
     case Key_L:
+        if (!static_cast<QFileSystemModel *>(model())->isDir(currentIndex()))
+            return clicked(currentIndex());
         expand(currentIndex());
         if (isExpanded(currentIndex()))
             clicked(currentIndex());
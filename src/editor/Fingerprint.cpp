@@ -0,0 +1,54 @@
+#include "Fingerprint.hpp"
+
+#include <QtEndian>
+
+#include <algorithm>
+
+namespace pico {
+
+Fingerprint::Fingerprint(size_t size)
+    : m_size(size),
+      m_count(size > samples * sampleSize ? samples : 1),
+      m_length(size > samples * sampleSize ? sampleSize : size),
+      m_pos(0),
+      m_sample(0),
+      m_hash(QCryptographicHash::Sha1)
+{
+    const quint64 bytes = qToLittleEndian<quint64>(size);
+    m_hash.addData(QByteArrayView(reinterpret_cast<const char *>(&bytes), sizeof(bytes)));
+}
+
+void
+Fingerprint::addData(std::string_view text)
+{
+    const size_t end = m_pos + text.size();
+    for (; m_sample < m_count; m_sample++) {
+        const size_t start = sampleStart(m_sample);
+        const size_t stop = start + m_length;
+        const size_t from = std::max(start, m_pos);
+        const size_t to = std::min(stop, end);
+        if (from < to)
+            m_hash.addData(QByteArrayView(text.data() + (from - m_pos), to - from));
+        /* the rest of the sample is in the next bytes */
+        if (stop > end)
+            break;
+    }
+    m_pos = end;
+}
+
+QByteArray
+Fingerprint::result(void) const
+{
+    return m_hash.result();
+}
+
+size_t
+Fingerprint::sampleStart(size_t index) const
+{
+    /* a text larger than all samples together spaces them at least a sample apart */
+    if (m_count == 1)
+        return 0;
+    return index * (m_size - m_length) / (m_count - 1);
+}
+
+} // namespace pico
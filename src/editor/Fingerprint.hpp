@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QByteArray>
+#include <QCryptographicHash>
+
+#include <string_view>
+
+namespace pico {
+
+/**
+ * Hash identifying a text without reading all of it, for the undo history to tell which saved
+ * state a file is in
+ *
+ * The SHA-1 covers the size of the text and samples spread evenly over it, a text small enough is
+ * hashed whole. Along with the inode, size and modification time of the file this tells apart
+ * files rewritten behind the editor's back, while opening a mapped file only pages in the samples.
+ */
+class Fingerprint
+{
+public:
+    explicit Fingerprint(size_t size);
+
+    /* the next bytes of the text, in order, only the parts that are sampled are read */
+    void
+    addData(std::string_view text);
+
+    QByteArray
+    result(void) const;
+
+private:
+    /* offset of the sample index */
+    size_t
+    sampleStart(size_t index) const;
+
+private:
+    static constexpr size_t samples = 64;
+    static constexpr size_t sampleSize = 4096;
+
+    size_t m_size;
+    size_t m_count;
+    size_t m_length;
+    /* bytes of the text seen so far and the first sample not complete yet */
+    size_t m_pos;
+    size_t m_sample;
+    QCryptographicHash m_hash;
+};
+
+} // namespace pico
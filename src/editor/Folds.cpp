@@ -0,0 +1,316 @@
+#include "Folds.hpp"
+
+#include <algorithm>
+
+namespace pico {
+
+namespace {
+
+constexpr size_t npos = PieceTable::npos;
+constexpr size_t tabWidth = 4;
+
+/* advance past a blank character of an indentation, false for anything else */
+bool
+indent(char c, size_t *width)
+{
+    if (c == ' ')
+        *width += 1;
+    else if (c == '\t')
+        *width += tabWidth;
+    else
+        return false;
+    return true;
+}
+
+/* width of the indentation of line, blank if it holds nothing else */
+size_t
+indentOf(const PieceTable &document, size_t line, bool *blank)
+{
+    size_t width = 0;
+    *blank = true;
+    document.scan(document.lineStart(line), false, [&](std::string_view text, size_t) {
+        for (char c : text) {
+            if (c == '\n')
+                return false;
+            if (!indent(c, &width)) {
+                *blank = false;
+                return false;
+            }
+        }
+        return true;
+    });
+    return width;
+}
+
+/* last line of those following line that are indented deeper than base, blank lines between them
+ * included, line itself if there are none */
+size_t
+blockEnd(const PieceTable &document, size_t line, size_t base)
+{
+    size_t last = line;
+    size_t current = line;
+    size_t width = 0;
+    bool blank = true;
+    bool ended = false;
+    document.scan(document.lineStart(line), false, [&](std::string_view text, size_t) {
+        for (char c : text) {
+            if (c == '\n') {
+                if (current > line && !blank) {
+                    if (width <= base) {
+                        ended = true;
+                        return false;
+                    }
+                    last = current;
+                }
+                current++;
+                width = 0;
+                blank = true;
+            } else if (blank && !indent(c, &width)) {
+                blank = false;
+            }
+        }
+        return true;
+    });
+    /* the last line of the document has no newline ending it */
+    if (!ended && current > line && !blank && width > base)
+        last = current;
+    return last;
+}
+
+/* nearest line above line that is indented less than base, npos if there is none */
+size_t
+blockStart(const PieceTable &document, size_t line, size_t base)
+{
+    /* going backward, the blanks seen since the last other character are the indentation */
+    size_t header = npos;
+    size_t current = line;
+    size_t width = 0;
+    bool blank = true;
+    document.scan(document.lineStart(line), true, [&](std::string_view text, size_t) {
+        for (size_t i = text.size(); i-- > 0;) {
+            const char c = text[i];
+            if (c == '\n') {
+                if (current < line && !blank && width < base) {
+                    header = current;
+                    return false;
+                }
+                current--;
+                width = 0;
+                blank = true;
+            } else if (!indent(c, &width)) {
+                width = 0;
+                blank = false;
+            }
+        }
+        return true;
+    });
+    if (header == npos && current == 0 && line > 0 && !blank && width < base)
+        header = 0;
+    return header;
+}
+
+} // namespace
+
+Folds::Folds(void)
+    : m_folds(),
+      m_hidden(1, 0)
+{}
+
+bool
+Folds::empty(void) const
+{
+    return m_folds.empty();
+}
+
+void
+Folds::fold(size_t first, size_t last)
+{
+    if (last <= first)
+        return;
+    auto overlaps = [&](const Fold &fold) {
+        if (fold.first > last || fold.last < first)
+            return false;
+        first = std::min(first, fold.first);
+        last = std::max(last, fold.last);
+        return true;
+    };
+    m_folds.erase(std::remove_if(m_folds.begin(), m_folds.end(), overlaps), m_folds.end());
+    auto it = std::lower_bound(m_folds.begin(), m_folds.end(), first,
+                               [](const Fold &fold, size_t value) {
+                                   return fold.first < value;
+                               });
+    m_folds.insert(it, { first, last });
+    updateHidden();
+}
+
+bool
+Folds::unfold(size_t line)
+{
+    const Fold *fold = foldAt(line);
+    if (fold == nullptr)
+        return false;
+    m_folds.erase(m_folds.begin() + (fold - m_folds.data()));
+    updateHidden();
+    return true;
+}
+
+void
+Folds::clear(void)
+{
+    m_folds.clear();
+    updateHidden();
+}
+
+const Folds::Fold *
+Folds::foldAt(size_t line) const
+{
+    auto it = std::partition_point(m_folds.begin(), m_folds.end(), [&](const Fold &fold) {
+        return fold.first <= line;
+    });
+    if (it == m_folds.begin() || (it - 1)->last < line)
+        return nullptr;
+    return &*(it - 1);
+}
+
+size_t
+Folds::rowOfLine(size_t line) const
+{
+    auto it = std::partition_point(m_folds.begin(), m_folds.end(), [&](const Fold &fold) {
+        return fold.first < line;
+    });
+    const size_t index = it - m_folds.begin();
+    if (index > 0 && line <= m_folds[index - 1].last)
+        return m_folds[index - 1].first - m_hidden[index - 1];
+    return line - m_hidden[index];
+}
+
+size_t
+Folds::lineOfRow(size_t row) const
+{
+    /* the rows of the first lines of the folds are as sorted as the folds */
+    size_t index = 0;
+    size_t count = m_folds.size();
+    while (count > 0) {
+        const size_t half = count / 2;
+        if (m_folds[index + half].first - m_hidden[index + half] < row) {
+            index += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    return row + m_hidden[index];
+}
+
+size_t
+Folds::hiddenLines(void) const
+{
+    return m_hidden.back();
+}
+
+size_t
+Folds::hiddenAfter(size_t line) const
+{
+    const Fold *fold = foldAt(line);
+    return fold && fold->first == line ? fold->last - fold->first : 0;
+}
+
+bool
+Folds::edit(size_t line, size_t removed, size_t added)
+{
+    if (m_folds.empty())
+        return false;
+
+    bool changed = false;
+    auto edited = [&](Fold &fold) {
+        if (fold.last < line)
+            return false;
+        if (fold.first > line + removed) {
+            fold.first = fold.first - removed + added;
+            fold.last = fold.last - removed + added;
+            return false;
+        }
+        /* an edit within the fold resizes it, one reaching out of it opens it */
+        if (fold.first <= line && line + removed <= fold.last) {
+            fold.last = fold.last - removed + added;
+            changed = changed || removed != added;
+            return fold.last <= fold.first;
+        }
+        changed = true;
+        return true;
+    };
+    m_folds.erase(std::remove_if(m_folds.begin(), m_folds.end(), edited), m_folds.end());
+    updateHidden();
+    return changed;
+}
+
+std::pair<size_t, size_t>
+Folds::markerRange(const PieceTable &document, size_t line)
+{
+    const size_t start = document.lineStart(line);
+    const size_t end = document.lineEnd(line);
+
+    /* a run of three braces is a marker, the braces of longer runs count in threes */
+    size_t opening = 0;
+    size_t closing = 0;
+    size_t depth = 0;
+    size_t close = npos;
+    document.scan(start, false, [&](std::string_view text, size_t offset) {
+        for (size_t i = 0; i < text.size(); i++) {
+            const char c = text[i];
+            opening = c == '{' ? opening + 1 : 0;
+            closing = c == '}' ? closing + 1 : 0;
+            if (opening == 3) {
+                depth++;
+                opening = 0;
+            } else if (closing == 3 && depth > 0) {
+                closing = 0;
+                if (--depth == 0) {
+                    close = offset + i;
+                    return false;
+                }
+            }
+            /* the marker opening the fold has to be on its first line */
+            if (depth == 0 && offset + i >= end)
+                return false;
+        }
+        return true;
+    });
+    if (close == npos || document.lineOf(close) == line)
+        return { npos, npos };
+    return { line, document.lineOf(close) };
+}
+
+std::pair<size_t, size_t>
+Folds::indentRange(const PieceTable &document, size_t line)
+{
+    bool blank = true;
+    const size_t width = indentOf(document, line, &blank);
+    if (blank)
+        return { npos, npos };
+
+    const size_t last = blockEnd(document, line, width);
+    if (last > line)
+        return { line, last };
+
+    /* a line heading no block is part of the block of the nearest line above indented less */
+    const size_t header = blockStart(document, line, width);
+    if (header == npos)
+        return { npos, npos };
+    bool headerBlank = true;
+    return { header, blockEnd(document, header, indentOf(document, header, &headerBlank)) };
+}
+
+void
+Folds::updateHidden(void)
+{
+    m_hidden.resize(m_folds.size() + 1);
+    size_t hidden = 0;
+    for (size_t i = 0; i < m_folds.size(); i++) {
+        m_hidden[i] = hidden;
+        hidden += m_folds[i].last - m_folds[i].first;
+    }
+    m_hidden.back() = hidden;
+}
+
+} // namespace pico
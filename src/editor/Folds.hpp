@@ -0,0 +1,90 @@
+#pragma once
+
+#include "editor/PieceTable.hpp"
+
+#include <utility>
+#include <vector>
+
+namespace pico {
+
+/**
+ * Closed folds of a document, mapping the rows of a view to the lines they show
+ *
+ * A fold shows its first line and hides the lines after it. Folds are kept sorted with the number
+ * of lines hidden before each one, so a row is mapped to its line and back with a binary search
+ * over the folds, never by walking the lines a fold hides. Edits move folds by the lines they add
+ * and remove like they move the states of a Highlighter.
+ */
+class Folds
+{
+public: /* types */
+    struct Fold {
+        size_t first;
+        size_t last;
+    };
+
+public:
+    Folds(void);
+
+    bool
+    empty(void) const;
+
+    /* close a fold over lines first to last, folds overlapping it become part of it */
+    void
+    fold(size_t first, size_t last);
+
+    /* open the fold hiding or showing line, false if there is none */
+    bool
+    unfold(size_t line);
+
+    void
+    clear(void);
+
+    /* fold line is part of, nullptr if there is none */
+    const Fold *
+    foldAt(size_t line) const;
+
+    /* row showing line, the row of its fold if it is hidden */
+    size_t
+    rowOfLine(size_t line) const;
+
+    /* line shown on row, rows past the last one count on from the last line */
+    size_t
+    lineOfRow(size_t row) const;
+
+    size_t
+    hiddenLines(void) const;
+
+    /* lines the fold starting at line hides, 0 if no fold starts there */
+    size_t
+    hiddenAfter(size_t line) const;
+
+    /*
+     * lines from line on changed, removed lines after it replaced by added ones, a fold the edit
+     * does not fall within is opened, returns whether a fold other than moving one changed
+     */
+    bool
+    edit(size_t line, size_t removed, size_t added);
+
+    /* lines from a line with a {{{ marker to the line with its }}}, npos if there is none */
+    static std::pair<size_t, size_t>
+    markerRange(const PieceTable &document, size_t line);
+
+    /*
+     * line and the lines indented deeper that follow it, or the block line is part of if none
+     * follow it, npos if line is not part of one
+     */
+    static std::pair<size_t, size_t>
+    indentRange(const PieceTable &document, size_t line);
+
+private:
+    void
+    updateHidden(void);
+
+private:
+    std::vector<Fold> m_folds;
+    /* lines hidden by the folds before each fold, and by all of them last */
+    std::vector<size_t> m_hidden;
+};
+
+} // namespace pico
@@ -0,0 +1,158 @@
+#include "GlyphCache.hpp"
+
+#include <QHash>
+#include <QTextOption>
+
+#include <algorithm>
+
+namespace pico {
+
+/* bookkeeping of an entry besides its text and glyphs, list node, hash node and key */
+constexpr size_t entryOverhead = sizeof(void *) * 8 + 64;
+
+GlyphCache::GlyphCache(size_t capacity)
+    : m_entries(),
+      m_index(),
+      m_capacity(capacity),
+      m_memory(0),
+      m_hits(0),
+      m_misses(0)
+{}
+
+const GlyphCache::runs_t &
+GlyphCache::runs(const QString &text,
+                 const QFont &font,
+                 const QList<QTextLayout::FormatRange> &formats,
+                 quint64 style)
+{
+    Key key{ text, style };
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        m_hits++;
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return it->second->runs;
+    }
+    m_misses++;
+
+    Entry entry{ std::move(key), shape(text, font, formats), 0 };
+    entry.memory = entryOverhead + text.size() * sizeof(QChar);
+    for (const Run &run : entry.runs) {
+        const size_t glyphs = run.glyphs.glyphIndexes().size();
+        entry.memory += sizeof(Run) + glyphs * (sizeof(quint32) + sizeof(QPointF));
+    }
+
+    m_memory += entry.memory;
+    m_entries.push_front(std::move(entry));
+    m_index.emplace(m_entries.front().key, m_entries.begin());
+    evict();
+    return m_entries.front().runs;
+}
+
+void
+GlyphCache::clear(void)
+{
+    m_index.clear();
+    m_entries.clear();
+    m_memory = 0;
+}
+
+size_t
+GlyphCache::hits(void) const
+{
+    return m_hits;
+}
+
+size_t
+GlyphCache::misses(void) const
+{
+    return m_misses;
+}
+
+size_t
+GlyphCache::memory(void) const
+{
+    return m_memory;
+}
+
+size_t
+GlyphCache::capacity(void) const
+{
+    return m_capacity;
+}
+
+void
+GlyphCache::setCapacity(size_t capacity)
+{
+    m_capacity = capacity;
+    evict();
+}
+
+bool
+GlyphCache::Key::operator==(const Key &other) const
+{
+    return style == other.style && text == other.text;
+}
+
+size_t
+GlyphCache::KeyHash::operator()(const Key &key) const
+{
+    return qHash(key.text, static_cast<size_t>(key.style));
+}
+
+GlyphCache::runs_t
+GlyphCache::shape(const QString &text,
+                  const QFont &font,
+                  const QList<QTextLayout::FormatRange> &formats)
+{
+    QTextLayout layout(text, font);
+    QTextOption option;
+    option.setWrapMode(QTextOption::NoWrap);
+    layout.setTextOption(option);
+    layout.setFormats(formats);
+
+    layout.beginLayout();
+    QTextLine line = layout.createLine();
+    if (line.isValid())
+        line.setNumColumns(text.size());
+    layout.endLayout();
+
+    runs_t runs;
+    auto append = [&](int from, int length, const QColor &color) {
+        if (length <= 0)
+            return;
+        for (const QGlyphRun &glyphs : layout.glyphRuns(from, length))
+            runs.push_back({ glyphs, color });
+    };
+
+    /* glyph runs carry no color, collect them per format range so each can be drawn in its own */
+    QList<QTextLayout::FormatRange> ranges = formats;
+    std::sort(ranges.begin(), ranges.end(), [](const auto &a, const auto &b) {
+        return a.start < b.start;
+    });
+    int pos = 0;
+    for (const QTextLayout::FormatRange &range : ranges) {
+        append(pos, range.start - pos, {});
+        const QColor color = range.format.hasProperty(QTextFormat::ForegroundBrush)
+                                 ? range.format.foreground().color()
+                                 : QColor();
+        append(std::max(pos, range.start), range.start + range.length - std::max(pos, range.start),
+               color);
+        pos = std::max(pos, range.start + range.length);
+    }
+    append(pos, text.size() - pos, {});
+    return runs;
+}
+
+void
+GlyphCache::evict(void)
+{
+    /* the entry just added is always kept, even if it alone is over capacity */
+    while (m_memory > m_capacity && m_entries.size() > 1) {
+        const Entry &last = m_entries.back();
+        m_memory -= last.memory;
+        m_index.erase(last.key);
+        m_entries.pop_back();
+    }
+}
+
+} // namespace pico
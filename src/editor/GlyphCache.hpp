@@ -0,0 +1,103 @@
+#pragma once
+
+#include <QColor>
+#include <QFont>
+#include <QGlyphRun>
+#include <QList>
+#include <QString>
+#include <QTextLayout>
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace pico {
+
+/**
+ * LRU cache of shaped lines, keyed by the line text and a hash of its formatting, so repainting a
+ * line that has been seen before only draws glyphs and never shapes it again
+ *
+ * The cache is bounded by an estimate of the memory held by the glyph runs, it has to be cleared
+ * when the font changes.
+ */
+class GlyphCache
+{
+public: /* types */
+    struct Run {
+        QGlyphRun glyphs;
+        /* invalid to draw with the painter's pen */
+        QColor color;
+    };
+
+    using runs_t = std::vector<Run>;
+
+public:
+    explicit GlyphCache(size_t capacity = 8 * 1024 * 1024);
+
+    /*
+     * shaped runs of text in font, formats are only read on a miss and style must identify them,
+     * lines with the same text and style are assumed to be formatted the same
+     */
+    const runs_t &
+    runs(const QString &text,
+         const QFont &font,
+         const QList<QTextLayout::FormatRange> &formats = {},
+         quint64 style = 0);
+
+    void
+    clear(void);
+
+    size_t
+    hits(void) const;
+
+    size_t
+    misses(void) const;
+
+    /* estimated bytes held by the cached runs */
+    size_t
+    memory(void) const;
+
+    size_t
+    capacity(void) const;
+
+    void
+    setCapacity(size_t capacity);
+
+private: /* types */
+    struct Key {
+        QString text;
+        quint64 style;
+
+        bool
+        operator==(const Key &other) const;
+    };
+
+    struct KeyHash {
+        size_t
+        operator()(const Key &key) const;
+    };
+
+    struct Entry {
+        Key key;
+        runs_t runs;
+        size_t memory;
+    };
+
+private:
+    static runs_t
+    shape(const QString &text, const QFont &font, const QList<QTextLayout::FormatRange> &formats);
+
+    void
+    evict(void);
+
+private:
+    /* most recently used first */
+    std::list<Entry> m_entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_index;
+    size_t m_capacity;
+    size_t m_memory;
+    size_t m_hits;
+    size_t m_misses;
+};
+
+} // namespace pico
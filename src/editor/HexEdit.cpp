@@ -0,0 +1,430 @@
+#include "HexEdit.hpp"
+
+#include <QDebug>
+#include <QFontDatabase>
+#include <QKeyEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QSignalBlocker>
+
+#include <algorithm>
+#include <climits>
+
+#include "editor/Editor.hpp"
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+namespace pico {
+
+HexEdit::HexEdit(QWidget *parent)
+    : QAbstractScrollArea(parent),
+      PicoWidget(this),
+      m_filePath(),
+      m_file(),
+      m_data(nullptr),
+      m_size(0),
+      m_overlay(),
+      m_cursor(0),
+      m_lowNibble(false),
+      m_topRow(0),
+      m_rowsPerStep(1),
+      m_offsetDigits(8),
+      m_lineHeight(1),
+      m_ascent(0),
+      m_advance(1)
+{
+    using namespace Qt;
+
+    /* the columns only line up in a fixed pitch font */
+    QFont fixed = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    fixed.setPointSizeF(font().pointSizeF());
+    setFont(fixed);
+    viewport()->setAttribute(WA_OpaquePaintEvent);
+    setHorizontalScrollBarPolicy(ScrollBarAlwaysOff);
+    updateFontMetrics();
+
+    auto editor = Editor::getInstance();
+    connect(editor, &Editor::modeChange, this, [=](Mode) {
+        m_lowNibble = false;
+        viewport()->update(rowRect(m_cursor / bytesPerRow));
+    });
+
+    const auto move = [=](qint64 delta) {
+        return [=]() {
+            const qint64 count = std::max<qint64>(this->count(), 1);
+            setCursorPosition(m_cursor + delta * count);
+        };
+    };
+    addBinding({ Key_H }, Mode::Normal, move(-1));
+    addBinding({ Key_L }, Mode::Normal, move(1));
+    addBinding({ Key_K }, Mode::Normal, move(-bytesPerRow));
+    addBinding({ Key_J }, Mode::Normal, move(bytesPerRow));
+    addBinding({ CTRL | Key_U }, Mode::Normal, [=]() {
+        setCursorPosition(m_cursor - visibleRowCount() / 2 * bytesPerRow);
+    });
+    addBinding({ CTRL | Key_D }, Mode::Normal, [=]() {
+        setCursorPosition(m_cursor + visibleRowCount() / 2 * bytesPerRow);
+    });
+    addBinding({ Key_0 }, Mode::Normal, [=]() {
+        setCursorPosition(m_cursor - m_cursor % bytesPerRow);
+    });
+    addBinding({ SHIFT | Key_Dollar }, Mode::Normal, [=]() {
+        setCursorPosition(m_cursor - m_cursor % bytesPerRow + bytesPerRow - 1);
+    });
+    addBinding({ Key_G, Key_G }, Mode::Normal, [=]() {
+        setCursorPosition(0);
+    });
+    /* with a count G goes to that row, as it goes to a line in text */
+    addBinding({ SHIFT | Key_G }, Mode::Normal, [=]() {
+        const qint64 count = static_cast<qint64>(this->count());
+        setCursorPosition(count > 0 ? (count - 1) * bytesPerRow : m_size - 1);
+    });
+    /* bytes are only ever overwritten, the size and offsets of the file never change */
+    addBinding({ Key_I }, Mode::Normal, [=]() {
+        editor->setMode(Mode::Binary);
+    });
+    addBinding({ Key_R }, Mode::Normal, [=]() {
+        editor->setMode(Mode::Binary);
+    });
+}
+
+bool
+HexEdit::openFile(const QString &path)
+{
+    auto file = std::make_unique<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        qWarning() << "could not open" << path << file->errorString();
+        return false;
+    }
+    const uchar *data = nullptr;
+    if (file->size() > 0 && (data = file->map(0, file->size())) == nullptr) {
+        qWarning() << "could not map" << path << file->errorString();
+        return false;
+    }
+
+    /* closing the previous file unmaps it */
+    m_file = std::move(file);
+    m_filePath = path;
+    m_data = data;
+    m_size = data ? m_file->size() : 0;
+    m_overlay.clear();
+    m_cursor = 0;
+    m_lowNibble = false;
+    m_topRow = 0;
+
+    m_offsetDigits = 8;
+    for (qint64 size = m_size >> 32; size > 0; size >>= 4)
+        m_offsetDigits++;
+
+    updateScrollBar();
+    verticalScrollBar()->setValue(0);
+    viewport()->update();
+    return true;
+}
+
+const QString &
+HexEdit::filePath(void) const
+{
+    return m_filePath;
+}
+
+qint64
+HexEdit::size(void) const
+{
+    return m_size;
+}
+
+uchar
+HexEdit::byteAt(qint64 pos) const
+{
+    auto it = m_overlay.find(pos);
+    return it != m_overlay.end() ? it->second : m_data[pos];
+}
+
+void
+HexEdit::setByte(qint64 pos, uchar byte)
+{
+    if (pos < 0 || pos >= m_size)
+        return;
+    if (byte == m_data[pos])
+        m_overlay.erase(pos);
+    else
+        m_overlay[pos] = byte;
+    viewport()->update(rowRect(pos / bytesPerRow));
+}
+
+bool
+HexEdit::isModified(void) const
+{
+    return !m_overlay.empty();
+}
+
+bool
+HexEdit::save(void)
+{
+    if (m_overlay.empty())
+        return true;
+
+    auto editor = Editor::getInstance();
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadWrite)) {
+        emit editor->saved(m_filePath, false, file.errorString());
+        return false;
+    }
+
+    /* a page is copied from the mapping with its edits applied and written back whole */
+    QByteArray page;
+    for (auto it = m_overlay.begin(); it != m_overlay.end();) {
+        const qint64 start = it->first / pageSize * pageSize;
+        const qint64 length = std::min(pageSize, m_size - start);
+        page = QByteArray(reinterpret_cast<const char *>(m_data + start), length);
+        for (; it != m_overlay.end() && it->first < start + length; ++it)
+            page[it->first - start] = static_cast<char>(it->second);
+        if (!file.seek(start) || file.write(page) != length) {
+            emit editor->saved(m_filePath, false, file.errorString());
+            return false;
+        }
+    }
+    bool ok = file.flush();
+#ifdef Q_OS_UNIX
+    ok = ok && ::fsync(file.handle()) == 0;
+#endif
+    if (!ok) {
+        emit editor->saved(m_filePath, false, file.errorString());
+        return false;
+    }
+
+    /* the mapping is shared, it now reads what was written */
+    m_overlay.clear();
+    viewport()->update();
+    emit editor->saved(m_filePath, true, {});
+    return true;
+}
+
+qint64
+HexEdit::cursorPosition(void) const
+{
+    return m_cursor;
+}
+
+void
+HexEdit::setCursorPosition(qint64 pos)
+{
+    pos = std::clamp<qint64>(pos, 0, std::max<qint64>(m_size - 1, 0));
+    viewport()->update(rowRect(m_cursor / bytesPerRow));
+    m_cursor = pos;
+    m_lowNibble = false;
+    ensureCursorVisible();
+    viewport()->update(rowRect(m_cursor / bytesPerRow));
+}
+
+void
+HexEdit::keyPressEvent(QKeyEvent *event)
+{
+    switch (event->key()) {
+    case Qt::Key_Left:
+        return setCursorPosition(m_cursor - 1);
+    case Qt::Key_Right:
+        return setCursorPosition(m_cursor + 1);
+    case Qt::Key_Up:
+        return setCursorPosition(m_cursor - bytesPerRow);
+    case Qt::Key_Down:
+        return setCursorPosition(m_cursor + bytesPerRow);
+    }
+
+    if (Editor::getInstance()->mode() != Mode::Binary) {
+        dispatchKey(resolveKey(event->key()));
+        return;
+    }
+
+    if (event->key() == Qt::Key_Backspace)
+        return setCursorPosition(m_cursor - 1);
+    bool ok = false;
+    const int value = event->text().toInt(&ok, 16);
+    if (ok && event->text().size() == 1)
+        typeNibble(value);
+}
+
+void
+HexEdit::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(viewport());
+    const QRect dirty = event->rect();
+    painter.fillRect(dirty, palette().base());
+    painter.setPen(palette().text().color());
+    if (m_size == 0)
+        return;
+
+    const qint64 firstRow = m_topRow + std::max(0, static_cast<int>(dirty.top() / m_lineHeight));
+    const qint64 lastRow =
+        std::min(m_topRow + static_cast<qint64>(dirty.bottom() / m_lineHeight), rowCount() - 1);
+    const bool binary = Editor::getInstance()->mode() == Mode::Binary;
+    for (qint64 row = firstRow; row <= lastRow; row++) {
+        const qreal y = (row - m_topRow) * m_lineHeight;
+        const qint64 start = row * bytesPerRow;
+        const int count = static_cast<int>(std::min<qint64>(bytesPerRow, m_size - start));
+
+        /* edited bytes are marked behind both of their columns */
+        for (auto it = m_overlay.lower_bound(start); it != m_overlay.end(); ++it) {
+            if (it->first >= start + count)
+                break;
+            const int index = static_cast<int>(it->first - start);
+            painter.fillRect(cellRect(hexColumn(index), 2, y), palette().alternateBase());
+            painter.fillRect(cellRect(charColumn(index), 1, y), palette().alternateBase());
+        }
+
+        QString text = QString("%1  ").arg(start, m_offsetDigits, 16, QLatin1Char('0'));
+        QString chars;
+        for (int i = 0; i < bytesPerRow; i++) {
+            if (i < count) {
+                const uchar byte = byteAt(start + i);
+                text += QString("%1 ").arg(static_cast<uint>(byte), 2, 16, QLatin1Char('0'));
+                chars += QLatin1Char(byte >= 0x20 && byte < 0x7f ? static_cast<char>(byte) : '.');
+            } else {
+                text += "   ";
+            }
+            if (i == bytesPerRow / 2 - 1)
+                text += ' ';
+        }
+        painter.drawText(QPointF(0, y + m_ascent), text + ' ' + chars);
+
+        if (m_cursor < start || m_cursor >= start + count)
+            continue;
+        /* the nibble typed over next in Binary mode, the whole byte otherwise */
+        const int index = static_cast<int>(m_cursor - start);
+        const int column = hexColumn(index) + (binary && m_lowNibble ? 1 : 0);
+        const QRectF cursor = cellRect(column, binary ? 1 : 2, y);
+        painter.fillRect(cursor, palette().text());
+        painter.setPen(palette().base().color());
+        painter.drawText(QPointF(cursor.left(), y + m_ascent), text.mid(column, binary ? 1 : 2));
+        painter.setPen(palette().text().color());
+        painter.drawRect(cellRect(charColumn(index), 1, y).adjusted(0, 0, -1, -1));
+    }
+}
+
+void
+HexEdit::changeEvent(QEvent *event)
+{
+    QAbstractScrollArea::changeEvent(event);
+    if (event->type() == QEvent::FontChange) {
+        updateFontMetrics();
+        updateScrollBar();
+        viewport()->update();
+    }
+}
+
+void
+HexEdit::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBar();
+}
+
+void
+HexEdit::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    Q_UNUSED(dy);
+    m_topRow = std::min(verticalScrollBar()->value() * m_rowsPerStep, rowCount() - 1);
+    viewport()->update();
+}
+
+void
+HexEdit::typeNibble(int value)
+{
+    if (m_size == 0)
+        return;
+    const uchar byte = byteAt(m_cursor);
+    if (!m_lowNibble) {
+        setByte(m_cursor, static_cast<uchar>(value << 4 | (byte & 0x0f)));
+        m_lowNibble = true;
+        return;
+    }
+    setByte(m_cursor, static_cast<uchar>((byte & 0xf0) | value));
+    /* the last byte stays under the cursor, typing on starts it over */
+    setCursorPosition(m_cursor + 1);
+}
+
+qint64
+HexEdit::rowCount(void) const
+{
+    return std::max<qint64>((m_size + bytesPerRow - 1) / bytesPerRow, 1);
+}
+
+int
+HexEdit::visibleRowCount(void) const
+{
+    return static_cast<int>(viewport()->height() / m_lineHeight) + 1;
+}
+
+QRect
+HexEdit::rowRect(qint64 row) const
+{
+    /* rows far off screen would overflow the int coordinates, they have nothing to repaint */
+    if (row < m_topRow || row > m_topRow + visibleRowCount())
+        return QRect();
+    const qreal y = (row - m_topRow) * m_lineHeight;
+    return QRect(0, static_cast<int>(y), viewport()->width(), static_cast<int>(m_lineHeight) + 1);
+}
+
+QRectF
+HexEdit::cellRect(int column, int columns, qreal y) const
+{
+    return QRectF(column * m_advance, y, columns * m_advance, m_lineHeight);
+}
+
+int
+HexEdit::hexColumn(int index) const
+{
+    return m_offsetDigits + 2 + index * 3 + (index >= bytesPerRow / 2 ? 1 : 0);
+}
+
+int
+HexEdit::charColumn(int index) const
+{
+    return hexColumn(bytesPerRow) + 1 + index;
+}
+
+void
+HexEdit::updateFontMetrics(void)
+{
+    const QFontMetricsF metrics(font());
+    m_lineHeight = metrics.lineSpacing();
+    m_ascent = metrics.ascent();
+    m_advance = metrics.horizontalAdvance(QLatin1Char('0'));
+}
+
+void
+HexEdit::ensureCursorVisible(void)
+{
+    const qint64 rows = std::max(1, visibleRowCount() - 1);
+    const qint64 row = m_cursor / bytesPerRow;
+    qint64 top = m_topRow;
+    if (row < top)
+        top = row;
+    else if (row >= top + rows)
+        top = row - rows + 1;
+    if (top == m_topRow)
+        return;
+
+    /* the scroll bar only follows, with more rows than it has steps it cannot place the row */
+    m_topRow = top;
+    const QSignalBlocker blocker(verticalScrollBar());
+    verticalScrollBar()->setValue(static_cast<int>(top / m_rowsPerStep));
+    viewport()->update();
+}
+
+void
+HexEdit::updateScrollBar(void)
+{
+    const qint64 rows = rowCount();
+    m_rowsPerStep = (rows + INT_MAX - 1) / INT_MAX;
+    auto *scrollBar = verticalScrollBar();
+    scrollBar->setRange(0, static_cast<int>((rows - 1) / m_rowsPerStep));
+    scrollBar->setPageStep(std::max<qint64>(visibleRowCount() / m_rowsPerStep, 1));
+}
+
+} // namespace pico
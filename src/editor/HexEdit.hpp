@@ -0,0 +1,132 @@
+#pragma once
+
+#include "editor/PicoWidget.hpp"
+#include <QAbstractScrollArea>
+#include <QFile>
+
+#include <map>
+#include <memory>
+
+namespace pico {
+
+/**
+ * Hex editor over a mapped file, for Mode::Binary
+ *
+ * The file is never read as a whole, painting only touches the bytes of the visible rows so the
+ * pages behind them are all the kernel ever reads in, whatever the size of the file. Bytes are
+ * overwritten in place, each one edited is kept in a sparse overlay in front of the mapping and
+ * saving writes back only the pages holding one.
+ */
+class HexEdit : public QAbstractScrollArea, public PicoWidget
+{
+    Q_OBJECT
+
+public:
+    explicit HexEdit(QWidget *parent = nullptr);
+
+    bool
+    openFile(const QString &path);
+
+    const QString &
+    filePath(void) const;
+
+    qint64
+    size(void) const;
+
+    /* byte at pos as edited */
+    uchar
+    byteAt(qint64 pos) const;
+
+    /* overwrite the byte at pos, writing back the byte on disk drops it from the overlay */
+    void
+    setByte(qint64 pos, uchar byte);
+
+    bool
+    isModified(void) const;
+
+    /* write the pages holding edited bytes into the file in place, the rest is left untouched */
+    bool
+    save(void);
+
+    qint64
+    cursorPosition(void) const;
+
+    void
+    setCursorPosition(qint64 pos);
+
+protected:
+    void
+    keyPressEvent(QKeyEvent *event) override;
+
+    void
+    paintEvent(QPaintEvent *event) override;
+
+    void
+    changeEvent(QEvent *event) override;
+
+    void
+    resizeEvent(QResizeEvent *event) override;
+
+    void
+    scrollContentsBy(int dx, int dy) override;
+
+private:
+    /* type a hex digit over the high then the low nibble of the byte under the cursor */
+    void
+    typeNibble(int value);
+
+    qint64
+    rowCount(void) const;
+
+    int
+    visibleRowCount(void) const;
+
+    /* area of the row in the viewport, empty when the row is not on screen */
+    QRect
+    rowRect(qint64 row) const;
+
+    /* area of columns cells of the row at y, starting at column */
+    QRectF
+    cellRect(int column, int columns, qreal y) const;
+
+    /* column of the hex digits and of the character of byte index of a row */
+    int
+    hexColumn(int index) const;
+
+    int
+    charColumn(int index) const;
+
+    void
+    updateFontMetrics(void);
+
+    void
+    ensureCursorVisible(void);
+
+    void
+    updateScrollBar(void);
+
+private:
+    static constexpr int bytesPerRow = 16;
+    static constexpr qint64 pageSize = 4096;
+
+    QString m_filePath;
+    std::unique_ptr<QFile> m_file;
+    /* the mapped file, nullptr when it is empty */
+    const uchar *m_data;
+    qint64 m_size;
+    /* edited bytes by offset, never equal to the byte on disk */
+    std::map<qint64, uchar> m_overlay;
+    qint64 m_cursor;
+    /* the high nibble of the byte under the cursor has been typed */
+    bool m_lowNibble;
+    qint64 m_topRow;
+    /* rows per step of the scroll bar, whose range is an int */
+    qint64 m_rowsPerStep;
+    /* hex digits of the offset column */
+    int m_offsetDigits;
+    qreal m_lineHeight;
+    qreal m_ascent;
+    qreal m_advance;
+};
+
+} // namespace pico
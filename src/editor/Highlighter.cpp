@@ -0,0 +1,343 @@
+#include "Highlighter.hpp"
+
+#include <QFileInfo>
+#include <QTextCharFormat>
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+namespace pico {
+
+namespace {
+
+enum class Token {
+    Keyword,
+    Number,
+    String,
+    Comment,
+    Preprocessor,
+};
+
+/* sorted for binary search */
+constexpr std::string_view keywords[] = {
+    "alignas", "alignof", "and", "asm", "auto", "bool", "break", "case", "catch", "char",
+    "char16_t", "char32_t", "char8_t", "class", "co_await", "co_return", "co_yield", "concept",
+    "const", "const_cast", "consteval", "constexpr", "constinit", "continue", "decltype",
+    "default", "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export",
+    "extern", "false", "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable",
+    "namespace", "new", "noexcept", "not", "nullptr", "operator", "or", "override", "private",
+    "protected", "public", "register", "reinterpret_cast", "requires", "return", "short", "signed",
+    "sizeof", "static", "static_assert", "static_cast", "struct", "switch", "template", "this",
+    "thread_local", "throw", "true", "try", "typedef", "typename", "union", "unsigned", "using",
+    "virtual", "void", "volatile", "wchar_t", "while",
+};
+
+bool
+isKeyword(std::string_view word)
+{
+    return std::binary_search(std::begin(keywords), std::end(keywords), word);
+}
+
+inline int
+code(char c)
+{
+    return static_cast<unsigned char>(c);
+}
+
+inline int
+code(QChar c)
+{
+    return c.unicode();
+}
+
+inline bool
+isIdentifier(int c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+inline bool
+isDigit(int c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/*
+ * lexes one line starting in state and returns the state it ends in, tokens are reported through
+ * emit(start, length, token) when tokens is set, otherwise only comments and strings are followed
+ */
+template<typename Char, typename Emit>
+Highlighter::State
+lex(const Char *s, size_t n, Highlighter::State state, bool tokens, Emit &&emit)
+{
+    auto at = [&](size_t i) {
+        return i < n ? code(s[i]) : 0;
+    };
+    auto commentEnd = [&](size_t from) {
+        for (size_t i = from; i + 1 < n; i++) {
+            if (at(i) == '*' && at(i + 1) == '/')
+                return i + 2;
+        }
+        return n + 1;
+    };
+
+    size_t i = 0;
+    if (state == Highlighter::State::BlockComment) {
+        const size_t end = commentEnd(0);
+        if (end > n) {
+            emit(0, n, Token::Comment);
+            return Highlighter::State::BlockComment;
+        }
+        emit(0, end, Token::Comment);
+        i = end;
+    }
+
+    if (tokens) {
+        size_t j = i;
+        while (at(j) == ' ' || at(j) == '\t')
+            j++;
+        if (at(j) == '#') {
+            size_t end = j + 1;
+            while (at(end) == ' ')
+                end++;
+            while (isIdentifier(at(end)))
+                end++;
+            emit(j, end - j, Token::Preprocessor);
+            i = end;
+        }
+    }
+
+    while (i < n) {
+        const int c = at(i);
+        if (c == '/' && at(i + 1) == '/') {
+            emit(i, n - i, Token::Comment);
+            return Highlighter::State::Normal;
+        }
+        if (c == '/' && at(i + 1) == '*') {
+            const size_t end = commentEnd(i + 2);
+            if (end > n) {
+                emit(i, n - i, Token::Comment);
+                return Highlighter::State::BlockComment;
+            }
+            emit(i, end - i, Token::Comment);
+            i = end;
+            continue;
+        }
+        if (c == '"' || c == '\'') {
+            size_t j = i + 1;
+            while (j < n && at(j) != c)
+                j += at(j) == '\\' ? 2 : 1;
+            const size_t end = std::min(j + 1, n);
+            emit(i, end - i, Token::String);
+            i = end;
+            continue;
+        }
+        if (!tokens) {
+            i++;
+            continue;
+        }
+        if (isDigit(c) || (c == '.' && isDigit(at(i + 1)))) {
+            size_t j = i + 1;
+            while (isIdentifier(at(j)) || at(j) == '.' || at(j) == '\'')
+                j++;
+            emit(i, j - i, Token::Number);
+            i = j;
+            continue;
+        }
+        if (isIdentifier(c)) {
+            size_t j = i + 1;
+            while (isIdentifier(at(j)))
+                j++;
+            /* keywords are short, longer identifiers need not be copied to be looked up */
+            if (j - i <= 16) {
+                char word[16];
+                for (size_t k = i; k < j; k++)
+                    word[k - i] = static_cast<char>(at(k));
+                if (isKeyword(std::string_view(word, j - i)))
+                    emit(i, j - i, Token::Keyword);
+            }
+            i = j;
+            continue;
+        }
+        i++;
+    }
+    return Highlighter::State::Normal;
+}
+
+const QTextCharFormat &
+format(Token token)
+{
+    static const std::array<QTextCharFormat, 5> formats = [] {
+        std::array<QTextCharFormat, 5> formats;
+        formats[static_cast<int>(Token::Keyword)].setForeground(QColor(0xc6, 0x78, 0xdd));
+        formats[static_cast<int>(Token::Number)].setForeground(QColor(0xd1, 0x9a, 0x66));
+        formats[static_cast<int>(Token::String)].setForeground(QColor(0x98, 0xc3, 0x79));
+        formats[static_cast<int>(Token::Comment)].setForeground(QColor(0x7f, 0x84, 0x8e));
+        formats[static_cast<int>(Token::Preprocessor)].setForeground(QColor(0x61, 0xaf, 0xef));
+        return formats;
+    }();
+    return formats[static_cast<int>(token)];
+}
+
+} // namespace
+
+Highlighter::Highlighter(const PieceTable &document)
+    : m_document(document),
+      m_states(),
+      m_dirty(npos),
+      m_dirtyEnd(0),
+      m_guessed(0)
+{}
+
+bool
+Highlighter::supports(const QString &path)
+{
+    static const QStringList suffixes = {
+        "c", "h", "cc", "hh", "cpp", "hpp", "cxx", "hxx", "inl",
+    };
+    return suffixes.contains(QFileInfo(path).suffix(), Qt::CaseInsensitive);
+}
+
+QList<QTextLayout::FormatRange>
+Highlighter::formats(size_t line, const QString &text, quint64 *style)
+{
+    const State state = entryState(line);
+    /* the formats only depend on the text and the entry state */
+    if (style)
+        *style = static_cast<quint64>(state) + 1;
+
+    QList<QTextLayout::FormatRange> formats;
+    lex(text.constData(), text.size(), state, true, [&](size_t start, size_t length, Token token) {
+        QTextLayout::FormatRange range;
+        range.start = static_cast<int>(start);
+        range.length = static_cast<int>(length);
+        range.format = format(token);
+        formats.append(range);
+    });
+    return formats;
+}
+
+void
+Highlighter::edit(size_t line, size_t removed, size_t added)
+{
+    if (line >= m_states.size())
+        return;
+
+    /* the lines below keep their stale states, they are what a re-lex converges against */
+    const auto after = m_states.begin() + line + 1;
+    if (removed > added)
+        m_states.erase(after, after + std::min<size_t>(removed - added, m_states.end() - after));
+    else
+        m_states.insert(after, added - removed, m_states[line]);
+
+    if (m_dirty == npos) {
+        m_dirty = line;
+        m_dirtyEnd = line + added;
+        return;
+    }
+    /* an earlier edit below moves with its lines, or was merged into this one */
+    if (m_dirtyEnd > line)
+        m_dirtyEnd = m_dirtyEnd > line + removed ? m_dirtyEnd - removed + added : line;
+    m_dirty = std::min(m_dirty, line);
+    m_dirtyEnd = std::max(m_dirtyEnd, line + added);
+}
+
+void
+Highlighter::reset(void)
+{
+    m_states.clear();
+    m_dirty = npos;
+    m_dirtyEnd = 0;
+    m_guessed = 0;
+}
+
+size_t
+Highlighter::lexedLines(void) const
+{
+    return m_states.size();
+}
+
+bool
+Highlighter::lexPending(void) const
+{
+    return guessedLine() > m_states.size();
+}
+
+void
+Highlighter::lexAhead(size_t count)
+{
+    const size_t target = std::min(guessedLine(), m_states.size() + count);
+    while (m_states.size() < target)
+        entryState(std::min(target, m_states.size() + maxLexAhead));
+    if (!lexPending())
+        m_guessed = 0;
+}
+
+size_t
+Highlighter::guessedLine(void) const
+{
+    /* called on every paint, counting the lines of a mapped file would index all of it */
+    if (m_guessed == 0)
+        return 0;
+    /* the guessed line was indexed to be painted, lines deleted since are not waited for */
+    return std::min(m_guessed, m_document.tree().metrics().newlines + 1);
+}
+
+Highlighter::State
+Highlighter::entryState(size_t line)
+{
+    if (line == 0)
+        return State::Normal;
+
+    /* re-lex stale lines above line, stopping early once a line ends as it did before the edit */
+    if (m_dirty != npos && m_dirty < line) {
+        size_t l = m_dirty;
+        State state = l > 0 ? m_states[l - 1] : State::Normal;
+        m_dirty = npos;
+        for (; l < m_states.size(); l++) {
+            const State next = lexLine(l, state);
+            const bool converged = l > m_dirtyEnd && next == m_states[l];
+            m_states[l] = next;
+            state = next;
+            if (converged)
+                break;
+            /* pausing, the next line is re-lexed unconditionally should an edit above it resume */
+            if (l + 1 >= line) {
+                if (l + 1 < m_states.size()) {
+                    m_dirty = l + 1;
+                    m_dirtyEnd = std::max(m_dirtyEnd, l + 1);
+                }
+                break;
+            }
+        }
+    }
+
+    if (line <= m_states.size())
+        return m_states[line - 1];
+
+    /* far beyond what has been lexed, e.g. after jumping to the end of a huge file */
+    if (line - m_states.size() > maxLexAhead) {
+        m_guessed = std::max(m_guessed, line);
+        return State::Normal;
+    }
+
+    State state = m_states.empty() ? State::Normal : m_states.back();
+    for (size_t l = m_states.size(); l < line; l++) {
+        state = lexLine(l, state);
+        m_states.push_back(state);
+    }
+    return state;
+}
+
+Highlighter::State
+Highlighter::lexLine(size_t line, State state) const
+{
+    const size_t start = m_document.lineStart(line);
+    if (start == PieceTable::npos)
+        return state;
+    const std::string text = m_document.text(start, m_document.lineEnd(line) - start);
+    return lex(text.data(), text.size(), state, false, [](size_t, size_t, Token) {});
+}
+
+} // namespace pico
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "editor/PieceTable.hpp"
+#include <QList>
+#include <QString>
+#include <QTextLayout>
+
+#include <vector>
+
+namespace pico {
+
+/**
+ * Incremental C/C++ syntax highlighter, the lexer state at the end of every line is stored so any
+ * line can be highlighted on its own from the state of the line above
+ *
+ * Lines are lexed lazily, only as far down as the view has asked for. An edit re-lexes from the
+ * edited line until a line ends in the same state it did before, below that nothing changed.
+ * A line far below the lexed ones is painted as if it started Normal, the lines up to it are left
+ * to lexAhead.
+ */
+class Highlighter
+{
+public: /* types */
+    enum class State : unsigned char {
+        Normal,
+        BlockComment,
+    };
+
+public:
+    explicit Highlighter(const PieceTable &document);
+
+    /* whether files at path are highlighted */
+    static bool
+    supports(const QString &path);
+
+    /*
+     * formats of text, the display text of line, and a style identifying them for a GlyphCache,
+     * the lines above are lexed first as far as needed
+     */
+    QList<QTextLayout::FormatRange>
+    formats(size_t line, const QString &text, quint64 *style);
+
+    /* removed lines after line were deleted and added lines inserted, line itself changed */
+    void
+    edit(size_t line, size_t removed, size_t added);
+
+    void
+    reset(void);
+
+    /* lines whose end state is known */
+    size_t
+    lexedLines(void) const;
+
+    /* whether a line was painted with a guessed state and the lines above it are not lexed yet */
+    bool
+    lexPending(void) const;
+
+    /* lex up to count more of the lines above the furthest line painted with a guessed state */
+    void
+    lexAhead(size_t count);
+
+private:
+    /* m_guessed if it is still in the document, 0 if no line was painted with a guess */
+    size_t
+    guessedLine(void) const;
+
+    /* state at the start of line, lexing the lines above it if they are close enough */
+    State
+    entryState(size_t line);
+
+    /* end state of line in the document */
+    State
+    lexLine(size_t line, State state) const;
+
+private:
+    /* a few screens, the view may jump this far past the lexed lines and still wait for them */
+    static constexpr size_t maxLexAhead = 1000;
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    const PieceTable &m_document;
+    /* end state of each lexed line */
+    std::vector<State> m_states;
+    /* first line whose stored state is stale, npos if none */
+    size_t m_dirty;
+    /* last line that was edited, stale states below it are only a guess to converge against */
+    size_t m_dirtyEnd;
+    /* furthest line painted as starting Normal because it was too far down, 0 if none */
+    size_t m_guessed;
+};
+
+} // namespace pico
@@ -4,9 +4,13 @@
 
 #include <QDebug>
 
+#include <algorithm>
+
 #define GEN_KEY64(X, Y) (static_cast<qint64>(X) | (static_cast<qint64>(Y) << 32))
 constexpr bool ERROR = false;
 constexpr bool SUCCESS = true;
+/* larger counts are clamped rather than overflowing */
+constexpr size_t maxCount = 999999999;
 
 namespace pico {
 
@@ -14,20 +18,45 @@ KeyListener::KeyListener(QObject *parent)
     : QObject(parent),
       m_keyMap(keymap_t{}),
       m_keyMapIndex(&m_keyMap),
+      m_digits(0),
+      m_count(0),
       m_editor(Editor::getInstance())
 {}
 
 bool
 KeyListener::handleKeyPress(key64_t key)
+{
+    return dispatch(resolve(key));
+}
+
+KeyListener::key64_t
+KeyListener::resolve(key64_t key) const
 {
     auto editor = static_cast<Editor *>(m_editor);
 
     key |= Qt::SHIFT * editor->shiftState();
     key |= Qt::CTRL * editor->controlState();
     key |= Qt::ALT * editor->altState();
+    return key;
+}
 
+bool
+KeyListener::dispatch(key64_t key)
+{
+    auto editor = static_cast<Editor *>(m_editor);
     auto it = m_keyMapIndex->find(GEN_KEY64(key, editor->mode()));
 
+    /* digits not bound at this point of a chord make up a count, 0 only ever continues one */
+    if (key >= Qt::Key_0 && key <= Qt::Key_9 &&
+        (m_digits > 0 || (key != Qt::Key_0 && it == m_keyMapIndex->end()))) {
+        m_digits = std::min<size_t>(m_digits * 10 + (key - Qt::Key_0), maxCount);
+        return true;
+    }
+    if (m_digits > 0) {
+        m_count = std::min<size_t>(std::max<size_t>(m_count, 1) * m_digits, maxCount);
+        m_digits = 0;
+    }
+
     if (it != m_keyMapIndex->end()) {
         value_t &val = it->second;
         if (val.callable) {
@@ -45,6 +74,12 @@ KeyListener::handleKeyPress(key64_t key)
     }
 }
 
+size_t
+KeyListener::count(void) const
+{
+    return m_count;
+}
+
 bool
 KeyListener::addBinding(QList<QKeyCombination> keyCombo, Mode mode, callback_t callback)
 {
@@ -86,6 +121,8 @@ void
 KeyListener::resetMapIndex(void)
 {
     m_keyMapIndex = &m_keyMap;
+    m_digits = 0;
+    m_count = 0;
 }
 
 } // namespace pico
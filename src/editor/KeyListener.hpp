@@ -17,9 +17,21 @@ public:
     virtual bool
     handleKeyPress(key64_t key);
 
+    /* key combined with the modifiers held, as it is looked up in the bindings */
+    key64_t
+    resolve(key64_t key) const;
+
+    /* follow a resolved key down the binding tree, calling the binding a chord ends in */
+    bool
+    dispatch(key64_t key);
+
     bool
     addBinding(QList<QKeyCombination> keyCombo, Mode mode, callback_t callback);
 
+    /* count typed in front of the binding being called, 0 if there was none */
+    size_t
+    count(void) const;
+
 protected:
     void
     resetMapIndex(void);
@@ -29,6 +41,9 @@ protected:
     keymap_t m_keyMap;
     /* tracks the key chord current state */
     keymap_t *m_keyMapIndex;
+    /* digits typed so far and the count they made up, as in 2d3w */
+    size_t m_digits;
+    size_t m_count;
     void *m_editor;
 };
 
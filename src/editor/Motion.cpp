@@ -0,0 +1,302 @@
+#include "Motion.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace pico {
+
+namespace {
+
+enum class CharClass {
+    Blank,
+    Word,
+    Punctuation,
+};
+
+bool
+isContinuationByte(char c)
+{
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+/* as in vim, anything outside ASCII is part of a word */
+CharClass
+classOf(char c, bool bigWord)
+{
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+        return CharClass::Blank;
+    const auto byte = static_cast<unsigned char>(c);
+    if (bigWord || byte >= 0x80 || std::isalnum(byte) || c == '_')
+        return CharClass::Word;
+    return CharClass::Punctuation;
+}
+
+/* call visit with each byte from pos on, or before pos back to 0, until it returns false */
+template <typename Visit>
+void
+forEachByte(const PieceTable &document, size_t pos, bool backward, Visit visit)
+{
+    document.scan(pos, backward, [&](std::string_view text, size_t offset) {
+        if (backward) {
+            for (size_t i = text.size(); i-- > 0;) {
+                if (!visit(text[i], offset + i))
+                    return false;
+            }
+        } else {
+            for (size_t i = 0; i < text.size(); i++) {
+                if (!visit(text[i], offset + i))
+                    return false;
+            }
+        }
+        return true;
+    });
+}
+
+} // namespace
+
+Motion::Motion(const PieceTable &document)
+    : m_document(document)
+{}
+
+size_t
+Motion::column(size_t start, size_t columns) const
+{
+    size_t target = start;
+    forEachByte(m_document, start, false, [&](char c, size_t at) {
+        if (c == '\n' || (!isContinuationByte(c) && columns-- == 0)) {
+            target = at;
+            return false;
+        }
+        target = at + 1;
+        return true;
+    });
+    return target;
+}
+
+size_t
+Motion::left(size_t pos, size_t count) const
+{
+    size_t target = pos;
+    forEachByte(m_document, pos, true, [&](char c, size_t at) {
+        if (c == '\n' || count == 0)
+            return false;
+        if (!isContinuationByte(c)) {
+            target = at;
+            count--;
+        }
+        return true;
+    });
+    return target;
+}
+
+size_t
+Motion::up(size_t pos, size_t count, size_t column) const
+{
+    const size_t line = m_document.lineOf(pos);
+    return this->column(m_document.lineStart(line - std::min(line, count)), column);
+}
+
+size_t
+Motion::down(size_t pos, size_t count, size_t column) const
+{
+    const size_t line = m_document.lineOf(pos);
+    size_t start = m_document.lineStart(line + std::min(count, PieceTable::npos - line - 1));
+    if (start == PieceTable::npos)
+        start = m_document.lineStart(m_document.lineCount() - 1);
+    return this->column(start, column);
+}
+
+size_t
+Motion::line(size_t line) const
+{
+    size_t target = m_document.lineStart(line);
+    if (target == PieceTable::npos)
+        target = m_document.lineStart(m_document.lineCount() - 1);
+    forEachByte(m_document, target, false, [&](char c, size_t at) {
+        target = at;
+        return c == ' ' || c == '\t';
+    });
+    return target;
+}
+
+size_t
+Motion::lineEnd(size_t pos, size_t count) const
+{
+    const size_t line = m_document.lineOf(pos);
+    /* past the last line the count is clamped */
+    if (m_document.lineStart(line + count) == PieceTable::npos)
+        return m_document.size();
+    return m_document.lineEnd(line + count - 1);
+}
+
+size_t
+Motion::wordForward(size_t pos, size_t count, bool bigWord) const
+{
+    size_t target = m_document.size();
+    bool first = true;
+    CharClass previous = CharClass::Blank;
+    bool newline = false;
+    forEachByte(m_document, pos, false, [&](char c, size_t at) {
+        const CharClass cls = classOf(c, bigWord);
+        /* a word starts where the class changes to a non-blank one, an empty line is a word too */
+        const bool start = (cls != CharClass::Blank && cls != previous) || (c == '\n' && newline);
+        if (!first && start && --count == 0) {
+            target = at;
+            return false;
+        }
+        first = false;
+        previous = cls;
+        newline = c == '\n';
+        return true;
+    });
+    return target;
+}
+
+size_t
+Motion::wordEnd(size_t pos, size_t count, bool bigWord) const
+{
+    /* from the last character there is nowhere to go */
+    size_t target = pos;
+    bool held = false;
+    CharClass previous = CharClass::Blank;
+    size_t lead = pos;
+    size_t previousLead = pos;
+    /* a word ends before the class changes, the rest of the character at pos is skipped */
+    forEachByte(m_document, pos + 1, false, [&](char c, size_t at) {
+        if (!held && isContinuationByte(c))
+            return true;
+        if (!isContinuationByte(c))
+            lead = at;
+        const CharClass cls = classOf(c, bigWord);
+        if (held && previous != CharClass::Blank && cls != previous && --count == 0) {
+            target = previousLead;
+            return false;
+        }
+        held = true;
+        previous = cls;
+        previousLead = lead;
+        return true;
+    });
+    /* the end of the document ends the last word, without enough words the last character */
+    if (count > 0 && held)
+        target = previousLead;
+    return target;
+}
+
+size_t
+Motion::wordBackward(size_t pos, size_t count, bool bigWord) const
+{
+    size_t target = 0;
+    bool held = false;
+    CharClass next = CharClass::Blank;
+    char nextChar = '\0';
+    size_t nextAt = 0;
+    /* a byte is looked at once the one before it is known, starting with the one before pos */
+    forEachByte(m_document, pos, true, [&](char c, size_t at) {
+        const CharClass cls = classOf(c, bigWord);
+        if (held) {
+            const bool start =
+                (next != CharClass::Blank && cls != next) || (nextChar == '\n' && c == '\n');
+            if (start && --count == 0) {
+                target = nextAt;
+                return false;
+            }
+        }
+        held = true;
+        next = cls;
+        nextChar = c;
+        nextAt = at;
+        return true;
+    });
+    return target;
+}
+
+size_t
+Motion::paragraphForward(size_t pos, size_t count) const
+{
+    const size_t line = m_document.lineOf(pos);
+    /* from an empty line the empty lines following it are skipped first */
+    bool text = m_document.lineStart(line) != m_document.lineEnd(line);
+    bool newline = false;
+    size_t target = m_document.size();
+    forEachByte(m_document, pos, false, [&](char c, size_t at) {
+        if (c == '\n' && newline && text) {
+            if (--count == 0) {
+                target = at;
+                return false;
+            }
+            text = false;
+        }
+        text = text || c != '\n';
+        newline = c == '\n';
+        return true;
+    });
+    return target;
+}
+
+size_t
+Motion::paragraphBackward(size_t pos, size_t count) const
+{
+    const size_t line = m_document.lineOf(pos);
+    bool text = m_document.lineStart(line) != m_document.lineEnd(line);
+    bool newline = false;
+    size_t nextAt = 0;
+    size_t target = 0;
+    forEachByte(m_document, pos, true, [&](char c, size_t at) {
+        /* the line starting after this newline is empty if it starts with one as well */
+        if (c == '\n' && newline && text) {
+            if (--count == 0) {
+                target = nextAt;
+                return false;
+            }
+            text = false;
+        }
+        text = text || c != '\n';
+        newline = c == '\n';
+        nextAt = at;
+        return true;
+    });
+    return target;
+}
+
+size_t
+Motion::matchingBracket(size_t pos) const
+{
+    static constexpr char brackets[] = "()[]{}";
+
+    const size_t end = m_document.lineEnd(m_document.lineOf(pos));
+    size_t bracket = PieceTable::npos;
+    size_t kind = 0;
+    forEachByte(m_document, pos, false, [&](char c, size_t at) {
+        if (at >= end)
+            return false;
+        const char *found = c != '\0' ? std::strchr(brackets, c) : nullptr;
+        if (found == nullptr)
+            return true;
+        bracket = at;
+        kind = found - brackets;
+        return false;
+    });
+    if (bracket == PieceTable::npos)
+        return PieceTable::npos;
+
+    /* opening brackets are at even indices, their match follows them */
+    const bool forward = kind % 2 == 0;
+    const char self = brackets[kind];
+    const char match = brackets[forward ? kind + 1 : kind - 1];
+    size_t depth = 0;
+    size_t target = PieceTable::npos;
+    forEachByte(m_document, forward ? bracket : bracket + 1, !forward, [&](char c, size_t at) {
+        if (c == self) {
+            depth++;
+        } else if (c == match && --depth == 0) {
+            target = at;
+            return false;
+        }
+        return true;
+    });
+    return target;
+}
+
+} // namespace pico
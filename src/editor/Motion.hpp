@@ -0,0 +1,70 @@
+#pragma once
+
+#include "editor/PieceTable.hpp"
+
+namespace pico {
+
+/**
+ * Vim motions computed on a PieceTable, each one returning the offset a cursor at pos moves to
+ *
+ * Line motions go straight through the line index of the document, so 100000j costs what j costs.
+ * Motions over words, paragraphs and brackets scan the text from pos a piece at a time and stop
+ * at their target, they never copy the text or look a byte up by offset.
+ */
+class Motion
+{
+public:
+    explicit Motion(const PieceTable &document);
+
+    /* columns codepoints after start, stopping at the end of its line */
+    size_t
+    column(size_t start, size_t columns) const;
+
+    /* count codepoints before pos, stopping at the start of its line */
+    size_t
+    left(size_t pos, size_t count) const;
+
+    /* column of the line count lines above or below the one containing pos, clamped */
+    size_t
+    up(size_t pos, size_t count, size_t column) const;
+
+    size_t
+    down(size_t pos, size_t count, size_t column) const;
+
+    /* first non-blank character of line, or of the last line past the end */
+    size_t
+    line(size_t line) const;
+
+    /* end of the line count - 1 lines below the one containing pos */
+    size_t
+    lineEnd(size_t pos, size_t count) const;
+
+    /*
+     * start of the count-th word after pos, end of the count-th word ending after it or start of
+     * the count-th word before it, big words being separated by whitespace only
+     */
+    size_t
+    wordForward(size_t pos, size_t count, bool bigWord) const;
+
+    size_t
+    wordEnd(size_t pos, size_t count, bool bigWord) const;
+
+    size_t
+    wordBackward(size_t pos, size_t count, bool bigWord) const;
+
+    /* the count-th empty line after or before the paragraph at pos, the document bounds if none */
+    size_t
+    paragraphForward(size_t pos, size_t count) const;
+
+    size_t
+    paragraphBackward(size_t pos, size_t count) const;
+
+    /* bracket matching the first one at or after pos on its line, npos if there is none */
+    size_t
+    matchingBracket(size_t pos) const;
+
+private:
+    const PieceTable &m_document;
+};
+
+} // namespace pico
@@ -19,6 +19,24 @@ PicoWidget::handleKeyPress(qint64 key)
     return m_keyListener.handleKeyPress(key);
 }
 
+qint64
+PicoWidget::resolveKey(qint64 key) const
+{
+    return m_keyListener.resolve(key);
+}
+
+bool
+PicoWidget::dispatchKey(qint64 key)
+{
+    return m_keyListener.dispatch(key);
+}
+
+size_t
+PicoWidget::count(void) const
+{
+    return m_keyListener.count();
+}
+
 bool
 PicoWidget::addBinding(QList<QKeyCombination> keyCombo, Mode mode, std::function<void()> callback)
 {
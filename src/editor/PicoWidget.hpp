@@ -11,6 +11,17 @@ protected:
     virtual bool
     handleKeyPress(qint64 key);
 
+    /* key with the modifiers held, and the binding lookup of such a resolved key */
+    qint64
+    resolveKey(qint64 key) const;
+
+    bool
+    dispatchKey(qint64 key);
+
+    /* count typed in front of the binding being called, 0 if there was none */
+    size_t
+    count(void) const;
+
 public:
     bool
     addBinding(QList<QKeyCombination> keyCombo, Mode mode, std::function<void()> callback);
@@ -0,0 +1,399 @@
+#include "PieceTable.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace pico {
+
+PieceTable::PieceTable(void)
+    : m_original(nullptr),
+      m_originalData(),
+      m_owner(nullptr),
+      m_add({}),
+      m_tree([this](const Piece &piece) {
+          return view(piece);
+      }),
+      m_indexed(0)
+{}
+
+PieceTable::PieceTable(std::string original)
+    : PieceTable()
+{
+    setOriginal(std::move(original));
+}
+
+void
+PieceTable::setOriginal(std::string original)
+{
+    m_original = std::make_shared<std::string>(std::move(original));
+    m_originalData = *m_original;
+    m_owner = m_original;
+    m_add.clear();
+    m_tree.clear();
+    m_indexed = 0;
+}
+
+void
+PieceTable::setOriginal(const char *data, size_t size, std::shared_ptr<const void> owner)
+{
+    m_original.reset();
+    m_originalData = std::string_view(data, size);
+    m_owner = std::move(owner);
+    m_add.clear();
+    m_tree.clear();
+    m_indexed = 0;
+}
+
+void
+PieceTable::appendOriginal(std::string_view text, const TextMetrics &metrics)
+{
+    assert(m_original && "mapped buffers are read-only");
+    indexTo(size());
+
+    /* a snapshot still reads the buffer, appending could move it so continue in a copy */
+    if (m_owner.use_count() > 2) {
+        auto copy = std::make_shared<std::string>();
+        copy->reserve(m_original->capacity());
+        copy->append(*m_original);
+        m_original = copy;
+        m_owner = m_original;
+    }
+
+    const Piece piece = { Piece::Source::Original, m_original->size(), text.size() };
+    m_original->append(text);
+    m_originalData = *m_original;
+    m_tree.append(piece, metrics);
+    m_indexed = m_original->size();
+}
+
+void
+PieceTable::clear(void)
+{
+    setOriginal({});
+}
+
+size_t
+PieceTable::size(void) const
+{
+    return m_tree.metrics().bytes + unindexed();
+}
+
+bool
+PieceTable::empty(void) const
+{
+    return size() == 0;
+}
+
+char
+PieceTable::at(size_t pos) const
+{
+    assert(pos < size());
+    indexTo(pos + 1);
+
+    char c = '\0';
+    m_tree.visit(pos, pos + 1, false, [&](const Piece &piece, size_t offset) {
+        c = view(piece)[pos - offset];
+        return false;
+    });
+    return c;
+}
+
+std::string
+PieceTable::text(void) const
+{
+    return text(0, size());
+}
+
+std::string
+PieceTable::text(size_t pos, size_t length) const
+{
+    std::string result;
+    if (pos >= size())
+        return result;
+    const size_t end = pos + std::min(length, size() - pos);
+    result.reserve(end - pos);
+    indexTo(end);
+
+    m_tree.visit(pos, end, false, [&](const Piece &piece, size_t offset) {
+        const size_t from = std::max(pos, offset) - offset;
+        const size_t to = std::min(end, offset + piece.length) - offset;
+        result.append(view(piece).substr(from, to - from));
+        return true;
+    });
+    return result;
+}
+
+void
+PieceTable::insert(size_t pos, std::string_view text)
+{
+    pos = std::min(pos, size());
+    indexTo(pos);
+
+    /* large pastes are chunked like loaded files */
+    for (size_t i = 0; i < text.size(); i += PieceTree::chunkSize) {
+        const std::string_view chunk = text.substr(i, PieceTree::chunkSize);
+        const Piece piece = { Piece::Source::Add, m_add.size(), chunk.size() };
+        m_add.append(chunk);
+        m_tree.insert(pos + i, piece);
+    }
+}
+
+void
+PieceTable::remove(size_t pos, size_t length)
+{
+    if (pos >= size() || length == 0)
+        return;
+    length = std::min(length, size() - pos);
+    indexTo(pos + length);
+    m_tree.remove(pos, length);
+}
+
+std::vector<Piece>
+PieceTable::pieces(size_t pos, size_t length) const
+{
+    std::vector<Piece> result;
+    if (pos >= size() || length == 0)
+        return result;
+    const size_t end = pos + std::min(length, size() - pos);
+    indexTo(end);
+
+    m_tree.visit(pos, end, false, [&](const Piece &piece, size_t offset) {
+        const size_t from = std::max(pos, offset) - offset;
+        const size_t to = std::min(end, offset + piece.length) - offset;
+        result.push_back({ piece.source, piece.start + from, to - from });
+        return true;
+    });
+    return result;
+}
+
+void
+PieceTable::splice(size_t pos, size_t length, const Piece *pieces, size_t count)
+{
+    remove(pos, length);
+    pos = std::min(pos, size());
+    indexTo(pos);
+
+    /* recorded pieces may be longer than a chunk, they are cut up again like pasted text */
+    for (size_t i = 0; i < count; i++) {
+        for (size_t done = 0; done < pieces[i].length; done += PieceTree::chunkSize) {
+            const Piece piece = { pieces[i].source, pieces[i].start + done,
+                                  std::min(PieceTree::chunkSize, pieces[i].length - done) };
+            m_tree.insert(pos, piece);
+            pos += piece.length;
+        }
+    }
+}
+
+Piece
+PieceTable::store(std::string_view text)
+{
+    const Piece piece = { Piece::Source::Add, m_add.size(), text.size() };
+    m_add.append(text);
+    return piece;
+}
+
+std::string_view
+PieceTable::original(void) const
+{
+    return m_originalData;
+}
+
+size_t
+PieceTable::findForward(size_t pos, char c) const
+{
+    size_t found = npos;
+    while (found == npos) {
+        m_tree.visit(pos, m_tree.metrics().bytes, false, [&](const Piece &piece, size_t offset) {
+            const std::string_view text = view(piece);
+            const size_t i = text.find(c, pos > offset ? pos - offset : 0);
+            if (i == std::string_view::npos)
+                return true;
+            found = offset + i;
+            return false;
+        });
+        /* continue the search in the next chunk of the original buffer */
+        pos = std::max(pos, m_tree.metrics().bytes);
+        if (found == npos && !indexChunk())
+            break;
+    }
+    return found;
+}
+
+size_t
+PieceTable::findBackward(size_t pos, char c) const
+{
+    size_t found = npos;
+    indexTo(pos);
+    m_tree.visit(0, std::min(pos, size()), true, [&](const Piece &piece, size_t offset) {
+        const std::string_view text = view(piece).substr(0, pos - offset);
+        const size_t i = text.rfind(c);
+        if (i == std::string_view::npos)
+            return true;
+        found = offset + i;
+        return false;
+    });
+    return found;
+}
+
+void
+PieceTable::scan(size_t pos, bool backward, const scanner_t &scanner) const
+{
+    if (backward) {
+        indexTo(pos);
+        m_tree.visit(0, std::min(pos, size()), true, [&](const Piece &piece, size_t offset) {
+            return scanner(view(piece).substr(0, pos - offset), offset);
+        });
+        return;
+    }
+
+    bool stopped = false;
+    while (!stopped) {
+        m_tree.visit(pos, m_tree.metrics().bytes, false, [&](const Piece &piece, size_t offset) {
+            const size_t skip = pos > offset ? pos - offset : 0;
+            stopped = !scanner(view(piece).substr(skip), offset + skip);
+            return !stopped;
+        });
+        /* carry on into the next chunk of the original buffer */
+        pos = std::max(pos, m_tree.metrics().bytes);
+        if (!stopped && !indexChunk())
+            break;
+    }
+}
+
+bool
+PieceTable::isIndexed(void) const
+{
+    return unindexed() == 0;
+}
+
+void
+PieceTable::indexTo(size_t end) const
+{
+    while (m_tree.metrics().bytes < end && indexChunk())
+        ;
+}
+
+void
+PieceTable::indexLines(size_t line) const
+{
+    while (m_tree.metrics().newlines < line && indexChunk())
+        ;
+}
+
+size_t
+PieceTable::lineCount(void) const
+{
+    indexTo(size());
+    return m_tree.metrics().newlines + 1;
+}
+
+size_t
+PieceTable::estimatedLineCount(void) const
+{
+    const TextMetrics &metrics = m_tree.metrics();
+    if (isIndexed() || m_indexed == 0)
+        return metrics.newlines + 1;
+    return metrics.newlines + 1 + unindexed() * metrics.newlines / m_indexed;
+}
+
+size_t
+PieceTable::lineOf(size_t pos) const
+{
+    pos = std::min(pos, size());
+    indexTo(pos);
+    return m_tree.metricsBefore(pos).newlines;
+}
+
+size_t
+PieceTable::lineStart(size_t line) const
+{
+    indexLines(line);
+    return m_tree.lineOffset(line);
+}
+
+size_t
+PieceTable::lineEnd(size_t line) const
+{
+    indexLines(line + 1);
+    const size_t next = m_tree.lineOffset(line + 1);
+    return next == PieceTree::npos ? size() : next - 1;
+}
+
+TextMetrics
+PieceTable::metricsBefore(size_t pos) const
+{
+    indexTo(pos);
+    return m_tree.metricsBefore(pos);
+}
+
+const PieceTree &
+PieceTable::tree(void) const
+{
+    return m_tree;
+}
+
+PieceTable::Snapshot
+PieceTable::snapshot(void) const
+{
+    Snapshot snapshot;
+    snapshot.owner = m_owner;
+    snapshot.original = m_originalData;
+
+    size_t added = 0;
+    m_tree.visit(0, m_tree.metrics().bytes, false, [&](const Piece &piece, size_t) {
+        snapshot.pieces.push_back(piece);
+        added += piece.source == Piece::Source::Add ? piece.length : 0;
+        return true;
+    });
+    if (!isIndexed())
+        snapshot.pieces.push_back({ Piece::Source::Original, m_indexed, unindexed() });
+
+    /* the add buffer keeps growing, copy out what the snapshot refers to */
+    snapshot.added.reserve(added);
+    for (Piece &piece : snapshot.pieces) {
+        if (piece.source != Piece::Source::Add)
+            continue;
+        const size_t start = snapshot.added.size();
+        snapshot.added.append(view(piece));
+        piece.start = start;
+    }
+    return snapshot;
+}
+
+std::string_view
+PieceTable::Snapshot::view(const Piece &piece) const
+{
+    const std::string_view buffer =
+        piece.source == Piece::Source::Original ? original : std::string_view(added);
+    return buffer.substr(piece.start, piece.length);
+}
+
+std::string_view
+PieceTable::view(const Piece &piece) const
+{
+    const std::string_view buffer =
+        piece.source == Piece::Source::Original ? m_originalData : std::string_view(m_add);
+    return buffer.substr(piece.start, piece.length);
+}
+
+bool
+PieceTable::indexChunk(void) const
+{
+    if (m_indexed >= m_originalData.size())
+        return false;
+
+    /* measuring the chunk is what pages a mapped file in */
+    const Piece piece = { Piece::Source::Original, m_indexed,
+                          std::min(PieceTree::chunkSize, m_originalData.size() - m_indexed) };
+    m_tree.append(piece, TextMetrics::measure(view(piece)));
+    m_indexed += piece.length;
+    return true;
+}
+
+size_t
+PieceTable::unindexed(void) const
+{
+    return m_originalData.size() - m_indexed;
+}
+
+} // namespace pico
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "editor/PieceTree.hpp"
+
+namespace pico {
+
+/**
+ * Piece-table document model
+ *
+ * The text is stored as UTF-8 in two buffers, a read-only original buffer holding the file as it
+ * was loaded and an append-only add buffer holding everything typed since. The document itself is
+ * the ordered sequence of pieces, each one a span of either buffer, kept in a PieceTree so an edit
+ * only splits or trims pieces and offsets and lines resolve in O(log n).
+ *
+ * The original buffer is indexed into the tree lazily, chunk by chunk, as queries reach further
+ * into the document. Combined with a memory-mapped original this means a file is only ever paged
+ * in as far as it has been viewed, edits never touch the mapping as they live in the add buffer.
+ */
+class PieceTable
+{
+public: /* types */
+    static constexpr size_t npos = std::string::npos;
+
+    /* called with the text of a piece and its document offset, returning false stops the walk */
+    typedef std::function<bool(std::string_view text, size_t offset)> scanner_t;
+
+    /**
+     * Immutable copy of the document that can be read from another thread while the table keeps
+     * being edited, it shares the original buffer and copies only the added text it refers to
+     */
+    struct Snapshot {
+        std::shared_ptr<const void> owner;
+        std::string_view original;
+        std::string added;
+        std::vector<Piece> pieces;
+
+        std::string_view
+        view(const Piece &piece) const;
+    };
+
+public: /* functions */
+    PieceTable(void);
+
+    explicit PieceTable(std::string original);
+
+    PieceTable(const PieceTable &) = delete;
+
+    void
+    operator=(const PieceTable &) = delete;
+
+    void
+    setOriginal(std::string original);
+
+    /* use size bytes at data as the original buffer, owner keeps the mapping alive */
+    void
+    setOriginal(const char *data, size_t size, std::shared_ptr<const void> owner);
+
+    /* append text measured by the caller to the original buffer, used for streamed loading */
+    void
+    appendOriginal(std::string_view text, const TextMetrics &metrics);
+
+    void
+    clear(void);
+
+    size_t
+    size(void) const;
+
+    bool
+    empty(void) const;
+
+    char
+    at(size_t pos) const;
+
+    std::string
+    text(void) const;
+
+    std::string
+    text(size_t pos, size_t length) const;
+
+    void
+    insert(size_t pos, std::string_view text);
+
+    void
+    remove(size_t pos, size_t length);
+
+    /* the pieces making up [pos, pos + length), cut to the range */
+    std::vector<Piece>
+    pieces(size_t pos, size_t length) const;
+
+    /* replace length bytes at pos with pieces of either buffer, used to undo and redo edits */
+    void
+    splice(size_t pos, size_t length, const Piece *pieces, size_t count);
+
+    /* add text to the add buffer without inserting it, for history read back from disk */
+    Piece
+    store(std::string_view text);
+
+    /* the original buffer, the document as it was opened */
+    std::string_view
+    original(void) const;
+
+    /* offset of the first c at or after pos, npos if there is none */
+    size_t
+    findForward(size_t pos, char c) const;
+
+    /* offset of the last c before pos, npos if there is none */
+    size_t
+    findBackward(size_t pos, char c) const;
+
+    /*
+     * walk the text from pos to the end of the document, or back from pos to its start, a piece
+     * at a time, the original buffer is indexed as the walk reaches it
+     */
+    void
+    scan(size_t pos, bool backward, const scanner_t &scanner) const;
+
+    /* true once the whole original buffer has been indexed */
+    bool
+    isIndexed(void) const;
+
+    /* index chunks of the original buffer until the document prefix [0, end) is indexed */
+    void
+    indexTo(size_t end) const;
+
+    /* index chunks of the original buffer until line is indexed */
+    void
+    indexLines(size_t line) const;
+
+    /* number of lines, indexes the whole document */
+    size_t
+    lineCount(void) const;
+
+    /* number of lines extrapolated from the indexed part, exact once isIndexed() */
+    size_t
+    estimatedLineCount(void) const;
+
+    /* line containing pos */
+    size_t
+    lineOf(size_t pos) const;
+
+    /* offset of the first byte of line, npos past the last line */
+    size_t
+    lineStart(size_t line) const;
+
+    /* offset of the newline ending line, or the document size for the last line */
+    size_t
+    lineEnd(size_t line) const;
+
+    /* metrics of the text in [0, pos) */
+    TextMetrics
+    metricsBefore(size_t pos) const;
+
+    const PieceTree &
+    tree(void) const;
+
+    Snapshot
+    snapshot(void) const;
+
+    std::string_view
+    view(const Piece &piece) const;
+
+private:
+    /* index the next chunk of the original buffer, false if there is none */
+    bool
+    indexChunk(void) const;
+
+    /* bytes of the original buffer not indexed yet, they follow the tree in the document */
+    size_t
+    unindexed(void) const;
+
+private:
+    /* owned original buffer, null when the original is a mapping */
+    std::shared_ptr<std::string> m_original;
+    std::string_view m_originalData;
+    /* keeps the memory behind m_originalData alive, shared with snapshots */
+    std::shared_ptr<const void> m_owner;
+    std::string m_add;
+    mutable PieceTree m_tree;
+    mutable size_t m_indexed;
+};
+
+} // namespace pico
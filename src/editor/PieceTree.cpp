@@ -0,0 +1,297 @@
+#include "PieceTree.hpp"
+
+#include "util/LineScanner.hpp"
+
+namespace pico {
+
+TextMetrics
+TextMetrics::measure(std::string_view text)
+{
+    /* a single vectorized pass, this runs over every chunk on load and on large pastes */
+    const LineScanner::Result scan = LineScanner::scan(text.data(), text.size());
+    TextMetrics metrics;
+    metrics.bytes = text.size();
+    metrics.newlines = scan.newlines;
+    metrics.codepoints = scan.codepoints;
+    /* 4-byte sequences are encoded as surrogate pairs in UTF-16 */
+    metrics.utf16 = scan.codepoints + scan.supplementary;
+    return metrics;
+}
+
+TextMetrics &
+TextMetrics::operator+=(const TextMetrics &other)
+{
+    bytes += other.bytes;
+    newlines += other.newlines;
+    codepoints += other.codepoints;
+    utf16 += other.utf16;
+    return *this;
+}
+
+TextMetrics &
+TextMetrics::operator-=(const TextMetrics &other)
+{
+    bytes -= other.bytes;
+    newlines -= other.newlines;
+    codepoints -= other.codepoints;
+    utf16 -= other.utf16;
+    return *this;
+}
+
+PieceTree::PieceTree(resolver_t resolve)
+    : m_resolve(std::move(resolve)),
+      m_root(nullptr),
+      m_seed(0x9E3779B9),
+      m_empty({})
+{}
+
+PieceTree::~PieceTree()
+{
+    destroy(m_root);
+}
+
+void
+PieceTree::clear(void)
+{
+    destroy(m_root);
+    m_root = nullptr;
+}
+
+const TextMetrics &
+PieceTree::metrics(void) const
+{
+    return m_root ? m_root->total : m_empty;
+}
+
+void
+PieceTree::insert(size_t pos, const Piece &piece)
+{
+    const TextMetrics metrics = TextMetrics::measure(m_resolve(piece));
+
+    Node *l, *r;
+    split(m_root, pos, &l, &r);
+
+    /* typing appends to the add buffer, so the piece before the cursor usually just grows */
+    Node *last = l;
+    while (last && last->right)
+        last = last->right;
+    if (last && last->piece.source == piece.source &&
+        last->piece.start + last->piece.length == piece.start &&
+        last->piece.length + piece.length <= chunkSize) {
+        for (Node *node = l; node; node = node->right)
+            node->total += metrics;
+        last->piece.length += piece.length;
+        last->metrics += metrics;
+        m_root = merge(l, r);
+        return;
+    }
+
+    m_root = merge(merge(l, createNode(piece, metrics)), r);
+}
+
+void
+PieceTree::append(const Piece &piece, const TextMetrics &metrics)
+{
+    m_root = merge(m_root, createNode(piece, metrics));
+}
+
+void
+PieceTree::remove(size_t pos, size_t length)
+{
+    Node *l, *m, *r;
+    split(m_root, pos, &l, &m);
+    split(m, length, &m, &r);
+    destroy(m);
+    m_root = merge(l, r);
+}
+
+TextMetrics
+PieceTree::metricsBefore(size_t pos) const
+{
+    TextMetrics result;
+    const Node *t = m_root;
+    while (t) {
+        const size_t leftBytes = bytes(t->left);
+        if (pos < leftBytes) {
+            t = t->left;
+            continue;
+        }
+        if (t->left)
+            result += t->left->total;
+        pos -= leftBytes;
+        if (pos < t->piece.length) {
+            result += TextMetrics::measure(m_resolve(t->piece).substr(0, pos));
+            break;
+        }
+        result += t->metrics;
+        pos -= t->piece.length;
+        t = t->right;
+    }
+    return result;
+}
+
+size_t
+PieceTree::lineOffset(size_t line) const
+{
+    if (line == 0)
+        return 0;
+    if (line > metrics().newlines)
+        return npos;
+
+    /* find the line-th newline, the line starts right after it */
+    size_t offset = 0;
+    const Node *t = m_root;
+    while (t) {
+        const size_t leftNewlines = newlines(t->left);
+        if (line <= leftNewlines) {
+            t = t->left;
+            continue;
+        }
+        line -= leftNewlines;
+        offset += bytes(t->left);
+        if (line <= t->metrics.newlines) {
+            const std::string_view text = m_resolve(t->piece);
+            return offset + LineScanner::findNthNewline(text.data(), text.size(), line) + 1;
+        }
+        line -= t->metrics.newlines;
+        offset += t->piece.length;
+        t = t->right;
+    }
+    return npos;
+}
+
+void
+PieceTree::visit(size_t from, size_t to, bool backward, const visitor_t &visitor) const
+{
+    if (from < to)
+        visit(m_root, 0, from, to, backward, visitor);
+}
+
+PieceTree::Node *
+PieceTree::createNode(const Piece &piece, const TextMetrics &metrics)
+{
+    /* xorshift32, the treap only needs priorities that are uncorrelated with the keys */
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return new Node{ piece, metrics, metrics, m_seed, nullptr, nullptr };
+}
+
+void
+PieceTree::destroy(Node *node)
+{
+    if (node == nullptr)
+        return;
+    destroy(node->left);
+    destroy(node->right);
+    delete node;
+}
+
+void
+PieceTree::update(Node *node)
+{
+    node->total = node->metrics;
+    if (node->left)
+        node->total += node->left->total;
+    if (node->right)
+        node->total += node->right->total;
+}
+
+size_t
+PieceTree::bytes(const Node *node)
+{
+    return node ? node->total.bytes : 0;
+}
+
+size_t
+PieceTree::newlines(const Node *node)
+{
+    return node ? node->total.newlines : 0;
+}
+
+void
+PieceTree::split(Node *t, size_t pos, Node **l, Node **r)
+{
+    if (t == nullptr) {
+        *l = *r = nullptr;
+        return;
+    }
+
+    const size_t leftBytes = bytes(t->left);
+    const size_t length = t->piece.length;
+
+    if (pos <= leftBytes) {
+        split(t->left, pos, l, &t->left);
+        update(t);
+        *r = t;
+    } else if (pos >= leftBytes + length) {
+        split(t->right, pos - leftBytes - length, &t->right, r);
+        update(t);
+        *l = t;
+    } else {
+        /* pos falls inside this piece, measure the shorter side and derive the other one */
+        const size_t cut = pos - leftBytes;
+        const std::string_view text = m_resolve(t->piece);
+        TextMetrics head, tail;
+        if (cut <= length - cut) {
+            head = TextMetrics::measure(text.substr(0, cut));
+            tail = t->metrics;
+            tail -= head;
+        } else {
+            tail = TextMetrics::measure(text.substr(cut));
+            head = t->metrics;
+            head -= tail;
+        }
+
+        Node *rest = createNode({ t->piece.source, t->piece.start + cut, length - cut }, tail);
+        Node *right = t->right;
+        t->piece.length = cut;
+        t->metrics = head;
+        t->right = nullptr;
+        update(t);
+
+        *l = t;
+        *r = merge(rest, right);
+    }
+}
+
+PieceTree::Node *
+PieceTree::merge(Node *l, Node *r)
+{
+    if (l == nullptr)
+        return r;
+    if (r == nullptr)
+        return l;
+
+    if (l->priority > r->priority) {
+        l->right = merge(l->right, r);
+        update(l);
+        return l;
+    }
+    r->left = merge(l, r->left);
+    update(r);
+    return r;
+}
+
+bool
+PieceTree::visit(const Node *t, size_t offset, size_t from, size_t to, bool backward,
+                 const visitor_t &visitor) const
+{
+    if (t == nullptr || to <= offset || from >= offset + t->total.bytes)
+        return true;
+
+    const size_t start = offset + bytes(t->left);
+    const size_t end = start + t->piece.length;
+    auto self = [&]() {
+        return (from < end && to > start) ? visitor(t->piece, start) : true;
+    };
+
+    if (backward) {
+        return visit(t->right, end, from, to, backward, visitor) && self() &&
+               visit(t->left, offset, from, to, backward, visitor);
+    }
+    return visit(t->left, offset, from, to, backward, visitor) && self() &&
+           visit(t->right, end, from, to, backward, visitor);
+}
+
+} // namespace pico
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+namespace pico {
+
+/**
+ * Summary of a span of UTF-8 text, all fields are additive so the summary of a subtree is the sum
+ * of its nodes
+ */
+struct TextMetrics {
+    size_t bytes = 0;
+    size_t newlines = 0;
+    size_t codepoints = 0;
+    size_t utf16 = 0;
+
+    static TextMetrics
+    measure(std::string_view text);
+
+    TextMetrics &
+    operator+=(const TextMetrics &other);
+
+    TextMetrics &
+    operator-=(const TextMetrics &other);
+};
+
+/**
+ * A span of one of the piece table's buffers
+ */
+struct Piece {
+    enum class Source : unsigned char {
+        Original,
+        Add,
+    };
+
+    Source source;
+    size_t start;
+    size_t length;
+};
+
+/**
+ * Balanced tree (treap) over the pieces of a document ordered by document offset, every node
+ * caches the metrics of its subtree so offsets, lines and codepoints resolve in O(log n)
+ */
+class PieceTree
+{
+public: /* types */
+    /* returns the text a piece refers to */
+    typedef std::function<std::string_view(const Piece &)> resolver_t;
+    /* called with each piece and its document offset, returning false stops the walk */
+    typedef std::function<bool(const Piece &, size_t)> visitor_t;
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    /* upper bound for pieces created from loaded or pasted text, bounds the cost of a split */
+    static constexpr size_t chunkSize = 64 * 1024;
+
+public: /* functions */
+    explicit PieceTree(resolver_t resolve);
+
+    ~PieceTree();
+
+    PieceTree(const PieceTree &) = delete;
+
+    void
+    operator=(const PieceTree &) = delete;
+
+    void
+    clear(void);
+
+    const TextMetrics &
+    metrics(void) const;
+
+    /* insert piece at pos, extending the preceding piece when the two are contiguous */
+    void
+    insert(size_t pos, const Piece &piece);
+
+    /* append a piece whose metrics are already known, used when loading */
+    void
+    append(const Piece &piece, const TextMetrics &metrics);
+
+    void
+    remove(size_t pos, size_t length);
+
+    /* metrics of the text in [0, pos) */
+    TextMetrics
+    metricsBefore(size_t pos) const;
+
+    /* offset of the first byte of line, npos if the document has fewer lines */
+    size_t
+    lineOffset(size_t line) const;
+
+    /* visit the pieces overlapping [from, to) in document order, or reversed when backward */
+    void
+    visit(size_t from, size_t to, bool backward, const visitor_t &visitor) const;
+
+private: /* types */
+    struct Node {
+        Piece piece;
+        TextMetrics metrics;
+        TextMetrics total;
+        uint32_t priority;
+        Node *left;
+        Node *right;
+    };
+
+private:
+    Node *
+    createNode(const Piece &piece, const TextMetrics &metrics);
+
+    void
+    destroy(Node *node);
+
+    static void
+    update(Node *node);
+
+    static size_t
+    bytes(const Node *node);
+
+    static size_t
+    newlines(const Node *node);
+
+    /* l receives the first pos bytes of t, r the rest, a piece straddling pos is cut in two */
+    void
+    split(Node *t, size_t pos, Node **l, Node **r);
+
+    static Node *
+    merge(Node *l, Node *r);
+
+    bool
+    visit(const Node *t, size_t offset, size_t from, size_t to, bool backward,
+          const visitor_t &visitor) const;
+
+private:
+    resolver_t m_resolve;
+    Node *m_root;
+    uint32_t m_seed;
+    TextMetrics m_empty;
+};
+
+} // namespace pico
@@ -0,0 +1,246 @@
+#include "ProjectSearcher.hpp"
+#include "editor/Searcher.hpp"
+#include "util/LineScanner.hpp"
+
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+namespace pico {
+
+static size_t
+codepoints(QStringView text)
+{
+    size_t count = 0;
+    for (const QChar c : text)
+        count += !c.isLowSurrogate();
+    return count;
+}
+
+/* report every line of text with a match, line is the number of the first line of text */
+static void
+matchLines(const QRegularExpression &regex,
+           const QString &path,
+           const QString &text,
+           size_t line,
+           qsizetype maxLength,
+           ProjectSearcher::matches_t &matches)
+{
+    const QStringView view(text);
+    qsizetype offset = 0;
+    qsizetype counted = 0;
+    while (offset <= text.size()) {
+        const QRegularExpressionMatch match = regex.match(text, offset);
+        if (!match.hasMatch())
+            break;
+        const qsizetype start = match.capturedStart();
+        const qsizetype lineStart = start > 0 ? text.lastIndexOf('\n', start - 1) + 1 : 0;
+        /* the empty remainder after a final newline is not a line */
+        if (lineStart == text.size() && lineStart > 0)
+            break;
+        qsizetype lineEnd = text.indexOf('\n', start);
+        if (lineEnd < 0)
+            lineEnd = text.size();
+
+        line += view.sliced(counted, lineStart - counted).count(u'\n');
+        counted = lineStart;
+        QStringView content = view.sliced(lineStart, lineEnd - lineStart);
+        if (content.endsWith(u'\r'))
+            content.chop(1);
+        matches.push_back({ path, line, codepoints(view.sliced(lineStart, start - lineStart)),
+                            content.left(maxLength).toString() });
+        offset = lineEnd + 1;
+    }
+}
+
+ProjectSearcher::ProjectSearcher(const QString &pattern, const QString &root, QObject *parent)
+    : QObject(parent),
+      m_pattern(pattern),
+      m_regex(pattern),
+      m_literal(Searcher::requiredLiteral(pattern)),
+      m_root(root),
+      m_pool(),
+      m_cancelled(false),
+      m_tasks(0),
+      m_files(0),
+      m_matches(0)
+{
+    qRegisterMetaType<pico::ProjectSearcher::matches_t>();
+
+    /* reads block on a cold cache, more threads than cores keep more of them in flight */
+    m_pool.setMaxThreadCount(std::max(4, QThread::idealThreadCount() * 2));
+}
+
+ProjectSearcher::~ProjectSearcher()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+bool
+ProjectSearcher::isValid(void) const
+{
+    return m_regex.isValid();
+}
+
+QString
+ProjectSearcher::errorString(void) const
+{
+    return m_regex.errorString();
+}
+
+const QString &
+ProjectSearcher::root(void) const
+{
+    return m_root;
+}
+
+void
+ProjectSearcher::start(void)
+{
+    if (!isValid()) {
+        emit finished(0, 0);
+        return;
+    }
+    post([this]() {
+        walk({}, nullptr);
+    });
+}
+
+void
+ProjectSearcher::cancel(void)
+{
+    m_cancelled = true;
+}
+
+void
+ProjectSearcher::post(std::function<void()> task)
+{
+    /* a task posts the work it finds before it is done, the count only drops to 0 at the end */
+    m_tasks++;
+    m_pool.start([this, task = std::move(task)]() {
+        if (!m_cancelled)
+            task();
+        if (--m_tasks == 0 && !m_cancelled)
+            emit finished(m_files, m_matches);
+    });
+}
+
+void
+ProjectSearcher::walk(const QString &dir, std::shared_ptr<const GitIgnore> ignore)
+{
+    const QString path = m_root + '/' + dir;
+    QFile gitignore(path + ".gitignore");
+    if (gitignore.open(QIODevice::ReadOnly)) {
+        auto rules = std::make_shared<GitIgnore>(dir.toStdString(), ignore);
+        rules->parse(gitignore.readAll().toStdString());
+        if (!rules->empty())
+            ignore = std::move(rules);
+    }
+
+    QStringList files;
+    QDirIterator it(path, QDir::Dirs | QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot |
+                              QDir::NoSymLinks);
+    while (it.hasNext() && !m_cancelled) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        if (info.fileName() == ".git")
+            continue;
+        const QString relative = dir + info.fileName();
+        if (ignore && ignore->ignored(relative.toStdString(), info.isDir()))
+            continue;
+
+        if (info.isDir()) {
+            post([=]() {
+                walk(relative + '/', ignore);
+            });
+        } else if (info.isFile()) {
+            files.append(relative);
+            if (files.size() == filesPerTask) {
+                post([this, batch = std::exchange(files, {})]() {
+                    searchFiles(batch);
+                });
+            }
+        }
+    }
+    searchFiles(files);
+}
+
+void
+ProjectSearcher::searchFiles(const QStringList &paths)
+{
+    if (paths.isEmpty())
+        return;
+
+    /* the expression is compiled per task, sharing one across the pool would serialize on it */
+    const QRegularExpression regex(m_pattern);
+    matches_t matches;
+    for (const QString &path : paths) {
+        if (m_cancelled)
+            return;
+        searchFile(path, regex, matches);
+    }
+    if (!matches.empty())
+        emit matchesFound(matches);
+}
+
+void
+ProjectSearcher::searchFile(const QString &path,
+                            const QRegularExpression &regex,
+                            matches_t &matches)
+{
+    QFile file(m_root + '/' + path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0)
+        return;
+    const uchar *mapped = file.map(0, file.size());
+    if (mapped == nullptr)
+        return;
+    const std::string_view text(reinterpret_cast<const char *>(mapped), file.size());
+    if (std::memchr(text.data(), '\0', std::min(text.size(), binaryProbe)))
+        return;
+
+    m_files++;
+    const size_t before = matches.size();
+    if (m_literal.empty()) {
+        /* a line at a time as well, so no match spans lines */
+        size_t line = 0;
+        size_t from = 0;
+        while (from < text.size() && !m_cancelled) {
+            const size_t lineEnd = text.find('\n', from);
+            const size_t to = lineEnd == std::string_view::npos ? text.size() : lineEnd;
+            matchLines(regex, path, QString::fromUtf8(text.data() + from, to - from), line++,
+                       maxLineLength, matches);
+            from = to + 1;
+        }
+    } else {
+        /* only lines containing the literal are decoded and matched */
+        size_t line = 0;
+        size_t counted = 0;
+        size_t pos = 0;
+        while (pos < text.size() && !m_cancelled) {
+            size_t hit = m_literal.find(text.data() + pos, text.size() - pos);
+            if (hit == LiteralFinder::npos)
+                break;
+            hit += pos;
+            const size_t lineStart = text.rfind('\n', hit);
+            const size_t from = lineStart == std::string_view::npos ? 0 : lineStart + 1;
+            const size_t lineEnd = text.find('\n', hit);
+            const size_t to = lineEnd == std::string_view::npos ? text.size() : lineEnd;
+
+            line += LineScanner::scan(text.data() + counted, from - counted).newlines;
+            counted = from;
+            matchLines(regex, path, QString::fromUtf8(text.data() + from, to - from), line,
+                       maxLineLength, matches);
+            pos = to + 1;
+        }
+    }
+    m_matches += matches.size() - before;
+}
+
+} // namespace pico
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <QObject>
+#include <QRegularExpression>
+#include <QString>
+#include <QThreadPool>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "util/GitIgnore.hpp"
+#include "util/LiteralFinder.hpp"
+
+namespace pico {
+
+/**
+ * Regex search over the files below a directory, walked on a pool of threads which each list a
+ * directory and search its files before moving on to the next one
+ *
+ * Files and directories matched by a .gitignore are skipped, as are files with a NUL byte near
+ * their start. The files searched are mapped rather than read and only lines containing the
+ * literal every match has to contain are decoded. Matches are reported once per line, in no
+ * particular order.
+ */
+class ProjectSearcher : public QObject
+{
+    Q_OBJECT
+
+public: /* types */
+    struct Match {
+        /* relative to the root */
+        QString path;
+        size_t line;
+        /* in codepoints */
+        size_t column;
+        QString text;
+    };
+
+    using matches_t = std::vector<Match>;
+
+public:
+    ProjectSearcher(const QString &pattern, const QString &root, QObject *parent = nullptr);
+
+    /* cancels the search and waits for the directories being searched */
+    ~ProjectSearcher();
+
+    bool
+    isValid(void) const;
+
+    QString
+    errorString(void) const;
+
+    const QString &
+    root(void) const;
+
+    void
+    start(void);
+
+    /* stop searching, no more matches are delivered */
+    void
+    cancel(void);
+
+signals:
+    /* matches of the files searched by one task, emitted from the pool */
+    void
+    matchesFound(const pico::ProjectSearcher::matches_t &matches);
+
+    void
+    finished(size_t files, size_t matches);
+
+private:
+    /* run task on the pool, finished is emitted once no task is left */
+    void
+    post(std::function<void()> task);
+
+    /* list dir, relative to the root and ending in '/', posting its subdirectories and files */
+    void
+    walk(const QString &dir, std::shared_ptr<const GitIgnore> ignore);
+
+    void
+    searchFiles(const QStringList &paths);
+
+    void
+    searchFile(const QString &path, const QRegularExpression &regex, matches_t &matches);
+
+private:
+    /* files searched per task, a directory with more is split across the pool */
+    static constexpr qsizetype filesPerTask = 64;
+    /* a NUL byte within this many bytes marks a file as binary, as grep does */
+    static constexpr size_t binaryProbe = 8192;
+    /* matched lines are cut off after this many characters */
+    static constexpr qsizetype maxLineLength = 256;
+
+    QString m_pattern;
+    QRegularExpression m_regex;
+    LiteralFinder m_literal;
+    QString m_root;
+    QThreadPool m_pool;
+    std::atomic<bool> m_cancelled;
+    std::atomic<size_t> m_tasks;
+    std::atomic<size_t> m_files;
+    std::atomic<size_t> m_matches;
+};
+
+} // namespace pico
+
+Q_DECLARE_METATYPE(pico::ProjectSearcher::matches_t)
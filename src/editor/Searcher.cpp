@@ -0,0 +1,326 @@
+#include "Searcher.hpp"
+
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+namespace pico {
+
+static bool
+isContinuationByte(char c)
+{
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+/*
+ * decode a line into text, with the byte each UTF-16 unit starts at in offsets, one past the last
+ * unit included. Offsets is left empty for ASCII, whose units are its bytes. Invalid bytes decode
+ * to U+FFFD one at a time, so matches after them still land on the bytes they were found in.
+ */
+static void
+decodeLine(std::string_view line, QString &text, std::vector<size_t> &offsets)
+{
+    offsets.clear();
+    if (std::all_of(line.begin(), line.end(), [](char c) {
+            return static_cast<unsigned char>(c) < 0x80;
+        })) {
+        text = QString::fromLatin1(line.data(), line.size());
+        return;
+    }
+
+    static constexpr char32_t least[] = { 0, 0, 0x80, 0x800, 0x10000 };
+    text.clear();
+    text.reserve(line.size());
+    offsets.reserve(line.size() + 1);
+    for (size_t i = 0; i < line.size();) {
+        const unsigned char lead = line[i];
+        const size_t length =
+            lead < 0x80 ? 1 : lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 0;
+        char32_t code = length > 1 ? lead & (0x7F >> length) : lead;
+        size_t n = 1;
+        for (; n < length && i + n < line.size() && isContinuationByte(line[i + n]); n++)
+            code = code << 6 | (line[i + n] & 0x3F);
+        /* truncated, overlong, surrogates and beyond U+10FFFF */
+        if (length == 0 || n < length || code < least[length] || code > 0x10FFFF ||
+            (code >= 0xD800 && code <= 0xDFFF)) {
+            code = QChar::ReplacementCharacter;
+            n = 1;
+        }
+        offsets.push_back(i);
+        if (QChar::requiresSurrogates(code)) {
+            text += QChar(QChar::highSurrogate(code));
+            text += QChar(QChar::lowSurrogate(code));
+            offsets.push_back(i);
+        } else {
+            text += QChar(static_cast<char16_t>(code));
+        }
+        i += n;
+    }
+    offsets.push_back(line.size());
+}
+
+Searcher::Searcher(const QString &pattern, PieceTable::Snapshot snapshot, QObject *parent)
+    : QObject(parent),
+      m_pattern(pattern),
+      m_regex(pattern),
+      m_literal(requiredLiteral(pattern)),
+      m_snapshot(std::move(snapshot)),
+      m_offsets(),
+      m_size(0),
+      m_chunks(0),
+      m_cancelled(false),
+      m_mutex(),
+      m_idle(),
+      m_running(0),
+      m_pending(),
+      m_next(0),
+      m_count(0)
+{
+    qRegisterMetaType<pico::Searcher::matches_t>();
+
+    m_offsets.reserve(m_snapshot.pieces.size());
+    for (const Piece &piece : m_snapshot.pieces) {
+        m_offsets.push_back(m_size);
+        m_size += piece.length;
+    }
+    m_chunks = (m_size + chunkSize - 1) / chunkSize;
+
+    connect(this, &Searcher::chunkSearched, this, &Searcher::deliver, Qt::QueuedConnection);
+}
+
+Searcher::~Searcher()
+{
+    cancel();
+    std::unique_lock lock(m_mutex);
+    m_idle.wait(lock, [this]() {
+        return m_running == 0;
+    });
+}
+
+bool
+Searcher::isValid(void) const
+{
+    return m_regex.isValid();
+}
+
+QString
+Searcher::errorString(void) const
+{
+    return m_regex.errorString();
+}
+
+void
+Searcher::start(void)
+{
+    if (!isValid() || m_chunks == 0) {
+        emit finished(0);
+        return;
+    }
+
+    m_running = m_chunks;
+    for (size_t index = 0; index < m_chunks; index++) {
+        QThreadPool::globalInstance()->start([this, index]() {
+            if (!m_cancelled)
+                searchChunk(index);
+            std::lock_guard lock(m_mutex);
+            if (--m_running == 0)
+                m_idle.notify_all();
+        });
+    }
+}
+
+void
+Searcher::cancel(void)
+{
+    m_cancelled = true;
+}
+
+size_t
+Searcher::count(void) const
+{
+    return m_count;
+}
+
+std::string
+Searcher::requiredLiteral(const QString &pattern)
+{
+    /* inline options such as (?i) change how literals match */
+    if (pattern.contains("(?") && pattern.count("(?") != pattern.count("(?:"))
+        return {};
+
+    QString best, run;
+    auto endRun = [&]() {
+        if (run.size() > best.size())
+            best = run;
+        run.clear();
+    };
+
+    /* only literals outside of groups are certain to be part of every match */
+    int depth = 0;
+    for (qsizetype i = 0; i < pattern.size(); i++) {
+        const QChar c = pattern[i];
+        if (c == '\\') {
+            const QChar next = i + 1 < pattern.size() ? pattern[++i] : QChar();
+            if (depth == 0 && QStringLiteral(".*+?()[]{}|^$\\/-").contains(next))
+                run += next;
+            else
+                endRun();
+        } else if (c == '[') {
+            /* skip the class, a ] right after the opening bracket is part of it */
+            i += i + 1 < pattern.size() && pattern[i + 1] == '^' ? 2 : 1;
+            if (i < pattern.size() && pattern[i] == ']')
+                i++;
+            while (i < pattern.size() && pattern[i] != ']')
+                i += pattern[i] == '\\' ? 2 : 1;
+            endRun();
+        } else if (c == '|') {
+            /* an alternative at the top level may match without any of the literals */
+            if (depth == 0)
+                return {};
+        } else if (c == '(') {
+            depth++;
+            endRun();
+        } else if (c == ')') {
+            depth--;
+            endRun();
+        } else if (c == '*' || c == '?' || c == '{') {
+            /* the character before the quantifier may not be there at all */
+            if (!run.isEmpty())
+                run.chop(1);
+            endRun();
+            while (c == '{' && i + 1 < pattern.size() && pattern[i] != '}')
+                i++;
+        } else if (c == '+' || c == '.' || c == '^' || c == '$') {
+            endRun();
+        } else if (depth == 0) {
+            run += c;
+        }
+    }
+    endRun();
+    return best.toStdString();
+}
+
+void
+Searcher::searchChunk(size_t index)
+{
+    /* a chunk owns the lines starting in it, including their part in the next chunk */
+    const size_t nominalEnd = std::min((index + 1) * chunkSize, m_size);
+    const size_t begin = lineStartIn(index * chunkSize, nominalEnd);
+    matches_t matches;
+    if (begin >= nominalEnd) {
+        emit chunkSearched(index, matches);
+        return;
+    }
+    const size_t end = lineStartIn(nominalEnd, m_size);
+    const std::string chunk = text(begin, end);
+
+    /* the expression is compiled per chunk, sharing one across the pool would serialize on it */
+    const QRegularExpression regex(m_pattern);
+    QString line;
+    std::vector<size_t> offsets;
+    auto search = [&](size_t from, size_t to) {
+        decodeLine(std::string_view(chunk.data() + from, to - from), line, offsets);
+        auto byte = [&](qsizetype unit) {
+            return offsets.empty() ? static_cast<size_t>(unit) : offsets[unit];
+        };
+        auto it = regex.globalMatch(line);
+        while (it.hasNext() && !m_cancelled) {
+            const QRegularExpressionMatch match = it.next();
+            const size_t start = byte(match.capturedStart());
+            matches.push_back({ begin + from + start, byte(match.capturedEnd()) - start });
+        }
+    };
+
+    if (m_literal.empty()) {
+        /* a line at a time as well, so no match spans lines */
+        size_t from = 0;
+        while (from < chunk.size() && !m_cancelled) {
+            const size_t lineEnd = chunk.find('\n', from);
+            const size_t to = lineEnd == std::string::npos ? chunk.size() : lineEnd;
+            search(from, to);
+            from = to + 1;
+        }
+    } else {
+        /* only lines containing the literal are decoded and matched */
+        size_t pos = 0;
+        while (pos < chunk.size() && !m_cancelled) {
+            size_t hit = m_literal.find(chunk.data() + pos, chunk.size() - pos);
+            if (hit == LiteralFinder::npos)
+                break;
+            hit += pos;
+            const size_t lineStart = chunk.rfind('\n', hit);
+            const size_t from = lineStart == std::string::npos ? 0 : lineStart + 1;
+            const size_t lineEnd = chunk.find('\n', hit);
+            const size_t to = lineEnd == std::string::npos ? chunk.size() : lineEnd;
+            search(from, to);
+            pos = to + 1;
+        }
+    }
+
+    if (!m_cancelled)
+        emit chunkSearched(index, matches);
+}
+
+void
+Searcher::deliver(size_t index, const matches_t &matches)
+{
+    if (m_cancelled)
+        return;
+
+    /* chunks finish in any order, hold them back until every chunk before them is in */
+    m_pending.emplace(index, matches);
+    matches_t ready;
+    for (auto it = m_pending.begin(); it != m_pending.end() && it->first == m_next;) {
+        ready.insert(ready.end(), it->second.begin(), it->second.end());
+        it = m_pending.erase(it);
+        m_next++;
+    }
+
+    if (!ready.empty()) {
+        m_count += ready.size();
+        emit matchesFound(ready);
+    }
+    if (m_next == m_chunks)
+        emit finished(m_count);
+}
+
+size_t
+Searcher::lineStartIn(size_t from, size_t to) const
+{
+    if (from == 0)
+        return 0;
+
+    /* look for the newline ending the line before, starting at from - 1 */
+    size_t pos = from - 1;
+    auto it = std::upper_bound(m_offsets.begin(), m_offsets.end(), pos) - 1;
+    for (; it != m_offsets.end() && pos < to; ++it) {
+        const std::string_view piece = m_snapshot.view(m_snapshot.pieces[it - m_offsets.begin()]);
+        const size_t skip = pos - *it;
+        const size_t length = std::min(piece.size() - skip, to - pos);
+        const void *found = std::memchr(piece.data() + skip, '\n', length);
+        if (found)
+            return pos + (static_cast<const char *>(found) - (piece.data() + skip)) + 1;
+        pos += length;
+    }
+    return to;
+}
+
+std::string
+Searcher::text(size_t begin, size_t end) const
+{
+    std::string text;
+    text.reserve(end - begin);
+    auto it = std::upper_bound(m_offsets.begin(), m_offsets.end(), begin) - 1;
+    for (size_t pos = begin; pos < end; ++it) {
+        const std::string_view piece = m_snapshot.view(m_snapshot.pieces[it - m_offsets.begin()]);
+        const size_t skip = pos - *it;
+        const size_t length = std::min(piece.size() - skip, end - pos);
+        text.append(piece.data() + skip, length);
+        pos += length;
+    }
+    return text;
+}
+
+} // namespace pico
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QObject>
+#include <QRegularExpression>
+#include <QString>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "editor/PieceTable.hpp"
+#include "util/LiteralFinder.hpp"
+
+namespace pico {
+
+/**
+ * Regex search over a document snapshot, split into line aligned chunks searched on the global
+ * thread pool
+ *
+ * A literal every match has to contain is taken from the pattern and looked for first, chunks and
+ * lines without it never reach the regex engine. Matches do not span lines.
+ */
+class Searcher : public QObject
+{
+    Q_OBJECT
+
+public: /* types */
+    struct Match {
+        size_t offset;
+        size_t length;
+    };
+
+    using matches_t = std::vector<Match>;
+
+public:
+    Searcher(const QString &pattern, PieceTable::Snapshot snapshot, QObject *parent = nullptr);
+
+    /* cancels the search and waits for the chunks being searched */
+    ~Searcher();
+
+    bool
+    isValid(void) const;
+
+    QString
+    errorString(void) const;
+
+    void
+    start(void);
+
+    /* stop searching, no more matches are delivered */
+    void
+    cancel(void);
+
+    /* matches delivered so far */
+    size_t
+    count(void) const;
+
+    /* literal every match of pattern contains, empty if none could be determined */
+    static std::string
+    requiredLiteral(const QString &pattern);
+
+signals:
+    /* the next matches in document order */
+    void
+    matchesFound(const pico::Searcher::matches_t &matches);
+
+    void
+    finished(size_t count);
+
+    /* a chunk is done, emitted from the pool and delivered in order by deliver */
+    void
+    chunkSearched(size_t index, const pico::Searcher::matches_t &matches);
+
+private:
+    void
+    searchChunk(size_t index);
+
+    void
+    deliver(size_t index, const matches_t &matches);
+
+    /* offset of the first line starting in [from, to), or to if there is none */
+    size_t
+    lineStartIn(size_t from, size_t to) const;
+
+    std::string
+    text(size_t begin, size_t end) const;
+
+private:
+    static constexpr size_t chunkSize = 1024 * 1024;
+
+    QString m_pattern;
+    QRegularExpression m_regex;
+    LiteralFinder m_literal;
+    PieceTable::Snapshot m_snapshot;
+    /* document offset of every piece in the snapshot */
+    std::vector<size_t> m_offsets;
+    size_t m_size;
+    size_t m_chunks;
+    std::atomic<bool> m_cancelled;
+
+    std::mutex m_mutex;
+    std::condition_variable m_idle;
+    size_t m_running;
+
+    /* chunks done out of order waiting for the ones before them */
+    std::map<size_t, matches_t> m_pending;
+    size_t m_next;
+    size_t m_count;
+};
+
+} // namespace pico
+
+Q_DECLARE_METATYPE(pico::Searcher::matches_t)
@@ -1,31 +1,1624 @@
 #include "TextEdit.hpp"
 #include "editor/Editor.hpp"
 
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QKeyEvent>
+#include <QScrollBar>
+
+#include <algorithm>
+#include <utility>
 
 using namespace Qt;
 namespace pico {
 
+/* files at least this large are memory-mapped instead of read */
+constexpr qint64 mapThreshold = 16 * 1024 * 1024;
+/* candidates cycled through by a completion */
+constexpr size_t maxCompletions = 32;
+/* macros replaying macros */
+constexpr unsigned maxReplayDepth = 100;
+
+static bool
+isContinuationByte(char c)
+{
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
 TextEdit::TextEdit(QWidget *parent)
-    : QTextEdit(parent),
-      PicoWidget(this)
+    : QAbstractScrollArea(parent),
+      PicoWidget(this),
+      m_document(),
+      m_highlighter(m_document),
+      m_undo(m_document),
+      m_motion(m_document),
+      m_folds(),
+      m_undoFile(nullptr),
+      m_filePath({}),
+      m_loader(nullptr),
+      m_loadState(LoadState::Loaded),
+      m_loadId(0),
+      m_encoding(),
+      m_saver(nullptr),
+      m_pendingSave({}),
+      m_view(new TextView(m_document, this)),
+      m_searcher(nullptr),
+      m_searchPattern({}),
+      m_matches(),
+      m_searchFrom(0),
+      m_searchJump(false),
+      m_matchesStale(false),
+      m_grep(nullptr),
+      m_resultsRoot({}),
+      m_results(),
+      m_pendingLine(PieceTable::npos),
+      m_pendingColumn(0),
+      m_insertGroup(false),
+      m_cursor(0),
+      m_cursors(),
+      m_blockAnchor(0),
+      m_macros(),
+      m_recording('\0'),
+      m_lastMacro('\0'),
+      m_replayDepth(0),
+      m_wordsIndexed(true),
+      m_completions(),
+      m_completion(0),
+      m_completionStart(0),
+      m_completionEnd(PieceTable::npos)
 {
     auto editor = Editor::getInstance();
 
+    setFocusPolicy(Qt::StrongFocus);
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    setViewport(m_view);
+    m_view->setFolds(&m_folds);
+
     addBinding({ Key_I }, Mode::Normal, [=]() {
         editor->setMode(Mode::Insert);
     });
+    addMotion({ Key_H }, MotionKind::Exclusive, [=](size_t pos, size_t count) {
+        return m_motion.left(pos, count);
+    });
+    addMotion({ Key_J }, MotionKind::Linewise, [=](size_t pos, size_t count) {
+        return rowMotion(pos, count, false);
+    });
+    addMotion({ Key_K }, MotionKind::Linewise, [=](size_t pos, size_t count) {
+        return rowMotion(pos, count, true);
+    });
+    addMotion({ Key_L }, MotionKind::Exclusive, [=](size_t pos, size_t count) {
+        return m_motion.column(pos, count);
+    });
+    addMotion({ Key_W }, MotionKind::Word, [=](size_t pos, size_t count) {
+        return m_motion.wordForward(pos, count, false);
+    });
+    addMotion({ SHIFT | Key_W }, MotionKind::Word, [=](size_t pos, size_t count) {
+        return m_motion.wordForward(pos, count, true);
+    });
+    addMotion({ Key_B }, MotionKind::Exclusive, [=](size_t pos, size_t count) {
+        return m_motion.wordBackward(pos, count, false);
+    });
+    addMotion({ SHIFT | Key_B }, MotionKind::Exclusive, [=](size_t pos, size_t count) {
+        return m_motion.wordBackward(pos, count, true);
+    });
+    addMotion({ Key_E }, MotionKind::Inclusive, [=](size_t pos, size_t count) {
+        return m_motion.wordEnd(pos, count, false);
+    });
+    addMotion({ SHIFT | Key_E }, MotionKind::Inclusive, [=](size_t pos, size_t count) {
+        return m_motion.wordEnd(pos, count, true);
+    });
+    addMotion({ SHIFT | Key_BraceRight }, MotionKind::Exclusive, [=](size_t pos, size_t count) {
+        return m_motion.paragraphForward(pos, count);
+    });
+    addMotion({ SHIFT | Key_BraceLeft }, MotionKind::Exclusive, [=](size_t pos, size_t count) {
+        return m_motion.paragraphBackward(pos, count);
+    });
+    addMotion({ Key_0 }, MotionKind::Exclusive, [=](size_t pos, size_t) {
+        return lineStart(pos);
+    });
+    addMotion({ SHIFT | Key_AsciiCircum }, MotionKind::Exclusive, [=](size_t pos, size_t) {
+        return m_motion.line(m_document.lineOf(pos));
+    });
+    addMotion({ SHIFT | Key_Dollar }, MotionKind::Exclusive, [=](size_t pos, size_t count) {
+        return m_motion.lineEnd(pos, count);
+    });
+    addMotion({ Key_G, Key_G }, MotionKind::Linewise, [=](size_t, size_t count) {
+        return m_motion.line(count - 1);
+    });
+    /* without a count G goes to the last line and % to the matching bracket */
+    addMotion({ SHIFT | Key_G }, MotionKind::Linewise, [=](size_t, size_t count) {
+        return m_motion.line(this->count() ? count - 1 : m_document.lineCount() - 1);
+    });
+    addMotion({ SHIFT | Key_Percent }, MotionKind::Inclusive, [=](size_t pos, size_t count) {
+        if (this->count()) {
+            const size_t lines = m_document.lineCount();
+            return m_motion.line((std::min<size_t>(count, 100) * lines + 99) / 100 - 1);
+        }
+        const size_t match = m_motion.matchingBracket(pos);
+        return match == PieceTable::npos ? pos : match;
+    });
+    for (Operator op : { Operator::Delete, Operator::Change, Operator::Yank }) {
+        addBinding({ operatorKey(op), operatorKey(op) }, Mode::Normal, [=]() {
+            const size_t count = std::max<size_t>(this->count(), 1);
+            operate(op, MotionKind::Linewise, [&](size_t pos) {
+                return m_motion.down(pos, count - 1, 0);
+            });
+        });
+    }
+    addBinding({ Key_X }, Mode::Normal, [=]() {
+        const size_t count = std::max<size_t>(this->count(), 1);
+        operate(Operator::Delete, MotionKind::Exclusive, [&](size_t pos) {
+            return m_motion.column(pos, count);
+        });
+    });
+    addBinding({ SHIFT | Key_D }, Mode::Normal, [=]() {
+        const size_t count = std::max<size_t>(this->count(), 1);
+        operate(Operator::Delete, MotionKind::Exclusive, [&](size_t pos) {
+            return m_motion.lineEnd(pos, count);
+        });
+    });
+    addBinding({ SHIFT | Key_C }, Mode::Normal, [=]() {
+        const size_t count = std::max<size_t>(this->count(), 1);
+        operate(Operator::Change, MotionKind::Exclusive, [&](size_t pos) {
+            return m_motion.lineEnd(pos, count);
+        });
+    });
+    addBinding({ Key_P }, Mode::Normal, [=]() {
+        put(false, std::max<size_t>(count(), 1));
+    });
+    addBinding({ SHIFT | Key_P }, Mode::Normal, [=]() {
+        put(true, std::max<size_t>(count(), 1));
+    });
+    for (char name = 'a'; name <= 'z'; name++) {
+        const auto key = static_cast<Qt::Key>(Key_A + (name - 'a'));
+        addBinding({ Key_Q, key }, Mode::Normal, [=]() {
+            startRecording(name);
+        });
+        addBinding({ SHIFT | Key_At, key }, Mode::Normal, [=]() {
+            replayMacro(name, std::max<size_t>(count(), 1));
+        });
+    }
+    addBinding({ SHIFT | Key_At, SHIFT | Key_At }, Mode::Normal, [=]() {
+        replayMacro('@', std::max<size_t>(count(), 1));
+    });
+    addBinding({ Key_Z, Key_C }, Mode::Normal, [=]() {
+        closeFold();
+    });
+    addBinding({ Key_Z, Key_O }, Mode::Normal, [=]() {
+        openFold();
+    });
+    addBinding({ Key_Z, Key_A }, Mode::Normal, [=]() {
+        if (m_folds.foldAt(cursorLine()))
+            openFold();
+        else
+            closeFold();
+    });
+    addBinding({ Key_Z, SHIFT | Key_R }, Mode::Normal, [=]() {
+        const size_t top = m_folds.lineOfRow(m_view->topRow());
+        m_folds.clear();
+        updateFolds(top);
+    });
+    addBinding({ CTRL | Key_N }, Mode::Insert, [=]() {
+        complete(false);
+    });
+    addBinding({ CTRL | Key_P }, Mode::Insert, [=]() {
+        complete(true);
+    });
+    addBinding({ CTRL | Key_V }, Mode::Normal, [=]() {
+        m_blockAnchor = m_cursor;
+        editor->setMode(Mode::VisualBlock);
+        updateBlock();
+    });
+    addBinding({ SHIFT | Key_I }, Mode::VisualBlock, [=]() {
+        editor->setMode(Mode::Insert);
+    });
+    addBinding({ Key_G, Key_Slash }, Mode::Normal, [=]() {
+        addCursorsAtMatches();
+    });
+    addBinding({ Key_N }, Mode::Normal, [=]() {
+        searchNext();
+    });
+    addBinding({ SHIFT | Key_N }, Mode::Normal, [=]() {
+        searchNext(true);
+    });
+    addBinding({ Key_U }, Mode::Normal, [=]() {
+        undo();
+    });
+    addBinding({ CTRL | Key_R }, Mode::Normal, [=]() {
+        redo();
+    });
+    addBinding({ Key_G, Key_Minus }, Mode::Normal, [=]() {
+        undoEarlier();
+    });
+    addBinding({ Key_G, SHIFT | Key_Plus }, Mode::Normal, [=]() {
+        undoLater();
+    });
+    addBinding({ Key_Return }, Mode::Normal, [=]() {
+        openResult();
+    });
+    addBinding({ Key_Enter }, Mode::Normal, [=]() {
+        openResult();
+    });
+
+    /* the cursor is drawn differently per mode */
+    auto setCursorStyle = [=](Mode mode) {
+        m_view->setCursorStyle(mode == Mode::Insert ? TextView::CursorStyle::Bar
+                                                    : TextView::CursorStyle::Block);
+    };
+    setCursorStyle(editor->mode());
+    connect(editor, &Editor::modeChange, m_view, setCursorStyle);
+
+    /* a whole Insert session is undone in one step */
+    connect(editor, &Editor::modeChange, this, [=](Mode mode) {
+        if (mode == Mode::Insert && !m_insertGroup)
+            m_undo.beginGroup();
+        else if (mode != Mode::Insert && m_insertGroup)
+            m_undo.endGroup();
+        m_insertGroup = mode == Mode::Insert;
+        m_completions.clear();
+    });
+    /* Escape in Normal mode drops the extra cursors, so does leaving a block but to insert */
+    connect(editor, &Editor::modeChange, this, [=, previous = editor->mode()](Mode mode) mutable {
+        if ((mode == Mode::Normal && previous == Mode::Normal) ||
+            (previous == Mode::VisualBlock && mode != Mode::Insert))
+            clearCursors();
+        previous = mode;
+    });
+    m_view->setCursors(&m_cursors);
+    /* painting may have indexed more of the document, refine the estimated line count */
+    connect(m_view, &TextView::documentIndexed, this, &TextEdit::updateScrollBar,
+            Qt::QueuedConnection);
+}
+
+TextEdit::~TextEdit()
+{
+    cancelLoading();
+    cancelSearch();
+    cancelGrep();
+    unindexDocument();
+    /* the history is written from the document, before it is gone */
+    delete m_undoFile;
+    /* never abandon a save, the user expects the file on disk once the buffer is gone */
+    if (m_saver)
+        m_saver->wait();
+}
+
+PieceTable &
+TextEdit::document(void)
+{
+    return m_document;
+}
+
+const TextView &
+TextEdit::view(void) const
+{
+    return *m_view;
+}
+
+bool
+TextEdit::openFile(const QString &path)
+{
+    auto file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        qWarning() << "could not open" << path << file->errorString();
+        return false;
+    }
+    cancelLoading();
+    cancelSearch();
+    cancelGrep();
+    unindexDocument();
+    delete m_undoFile;
+    m_undoFile = nullptr;
+    m_matches.clear();
+    m_searchPattern.clear();
+    m_results.clear();
+    m_pendingLine = PieceTable::npos;
+    m_encoding.reset();
+    m_view->setStatus({});
+
+    /* large files are mapped and only paged in as far as they are viewed */
+    const uchar *data = nullptr;
+    if (file->size() >= mapThreshold)
+        data = file->map(0, file->size());
+
+    if (data != nullptr) {
+        m_document.setOriginal(reinterpret_cast<const char *>(data), file->size(), file);
+        m_loadState = LoadState::Loaded;
+        /* reading it all for its words would defeat the mapping, they are never completed */
+        m_wordsIndexed = false;
+    } else {
+        std::string original;
+        original.reserve(file->size());
+        m_document.setOriginal(std::move(original));
+        m_loadState = LoadState::Loading;
+        m_wordsIndexed = true;
+
+        /* chunks are appended as they arrive, the first screen renders with the first one */
+        const quint64 id = ++m_loadId;
+        m_loader = new FileLoader(path, this);
+        connect(m_loader, &FileLoader::chunkLoaded, this,
+                [=](const QByteArray &chunk, const TextMetrics &metrics) {
+                    /* events still queued from a cancelled load are dropped */
+                    if (id != m_loadId)
+                        return;
+                    const size_t end = m_document.size();
+                    const size_t line = m_document.lineOf(end);
+                    editLines(line, 0, metrics.newlines);
+                    /* the last chunk may have been cut in the middle of a word */
+                    indexRanges({ { end, end } }, -1);
+                    m_document.appendOriginal(std::string_view(chunk.constData(), chunk.size()),
+                                              metrics);
+                    indexRanges({ { end, end + chunk.size() } }, 1);
+                    updateScrollBar();
+                    m_view->invalidate(end);
+                    if (m_pendingLine != PieceTable::npos &&
+                        m_document.lineStart(m_pendingLine + 1) != PieceTable::npos)
+                        gotoLine(m_pendingLine, m_pendingColumn);
+                });
+        connect(m_loader, &FileLoader::progress, this, [=](qint64 loaded, qint64 total) {
+            if (id == m_loadId)
+                emit loadProgress(loaded, total);
+        });
+        connect(m_loader, &FileLoader::finished, this, [=](bool ok, const QString &error) {
+            if (id != m_loadId)
+                return;
+            if (!ok)
+                qWarning() << "loading" << path << "failed:" << error;
+            m_loadState = ok ? LoadState::Loaded : LoadState::Partial;
+            m_encoding = m_loader->encoding();
+            m_loader->deleteLater();
+            m_loader = nullptr;
+            if (m_pendingLine != PieceTable::npos)
+                gotoLine(m_pendingLine, m_pendingColumn);
+        });
+        m_loader->start();
+    }
+    m_filePath = path;
+    m_cursor = 0;
+    m_cursors.clear();
+    m_highlighter.reset();
+    m_folds.clear();
+    m_undo.clear();
+    m_undoFile = new UndoFile(path, m_document, m_undo, this);
+    m_view->setHighlighter(Highlighter::supports(path) ? &m_highlighter : nullptr);
+
+    updateScrollBar();
+    verticalScrollBar()->setValue(0);
+    m_view->invalidate();
+    m_view->setCursorPosition(m_cursor);
+    return true;
+}
+
+bool
+TextEdit::isLoading(void) const
+{
+    return m_loadState == LoadState::Loading;
+}
+
+void
+TextEdit::cancelLoading(void)
+{
+    if (m_loader == nullptr)
+        return;
+
+    /* deleting the loader joins its thread, the id change drops the chunks still queued */
+    delete m_loader;
+    m_loader = nullptr;
+    m_loadId++;
+    m_loadState = LoadState::Partial;
+    emit loadProgress(1, 1);
+}
+
+bool
+TextEdit::isEditable(void) const
+{
+    return m_loadState == LoadState::Loaded;
+}
+
+bool
+TextEdit::save(const QString &path)
+{
+    const QString target = path.isEmpty() ? m_filePath : path;
+    if (target.isEmpty()) {
+        qWarning() << "no file name";
+        return false;
+    }
+    if (!isEditable()) {
+        qWarning() << "refusing to save" << target << "before it has been loaded completely";
+        return false;
+    }
+
+    /* saves are serialized so an older snapshot can never be renamed over a newer one */
+    if (m_saver) {
+        m_pendingSave = target;
+        return true;
+    }
+
+    if (m_filePath.isEmpty())
+        m_filePath = target;
+
+    /* the history learns which of its states the file now holds */
+    UndoFile *undoFile = target == m_filePath ? m_undoFile : nullptr;
+    if (undoFile)
+        undoFile->beginCheckpoint();
+
+    m_saver = new FileSaver(target, m_document.snapshot(), m_encoding, this);
+    connect(m_saver, &FileSaver::finished, Editor::getInstance(), &Editor::saved);
+    connect(m_saver, &FileSaver::finished, this, [=](const QString &, bool ok) {
+        if (undoFile && undoFile == m_undoFile)
+            undoFile->endCheckpoint(ok, m_saver->hash());
+        m_saver->deleteLater();
+        m_saver = nullptr;
+        if (!m_pendingSave.isEmpty())
+            save(std::exchange(m_pendingSave, {}));
+    });
+    m_saver->start();
+    return true;
+}
+
+bool
+TextEdit::isSaving(void) const
+{
+    return m_saver != nullptr;
+}
+
+const QString &
+TextEdit::filePath(void) const
+{
+    return m_filePath;
+}
+
+size_t
+TextEdit::cursorPosition(void) const
+{
+    return m_cursor;
+}
+
+void
+TextEdit::setCursorPosition(size_t pos)
+{
+    m_cursor = std::min(pos, m_document.size());
+    ensureCursorVisible();
+    m_view->setCursorPosition(m_cursor);
+}
+
+size_t
+TextEdit::cursorLine(void) const
+{
+    return m_document.lineOf(m_cursor);
+}
+
+size_t
+TextEdit::cursorColumn(void) const
+{
+    return columnOf(m_cursor);
+}
+
+void
+TextEdit::gotoLine(size_t line, size_t column)
+{
+    /* the line may not have arrived yet, or only part of it */
+    m_pendingLine = PieceTable::npos;
+    if (isLoading() && m_document.lineStart(line + 1) == PieceTable::npos) {
+        m_pendingLine = line;
+        m_pendingColumn = column;
+    }
+
+    size_t start = m_document.lineStart(line);
+    if (start == PieceTable::npos)
+        start = m_document.lineStart(m_document.lineCount() - 1);
+    setCursorPosition(m_motion.column(start, column));
+}
+
+const std::vector<size_t> &
+TextEdit::cursors(void) const
+{
+    return m_cursors;
+}
+
+void
+TextEdit::addCursorsAtMatches(void)
+{
+    if (m_matches.empty() || m_matchesStale)
+        return;
+
+    auto first = std::upper_bound(m_matches.begin(), m_matches.end(), m_cursor,
+                                  [](size_t pos, const Searcher::Match &match) {
+                                      return pos < match.offset;
+                                  });
+    if (first == m_matches.end())
+        first = m_matches.begin();
+    m_cursor = first->offset;
+    m_cursors.clear();
+    m_cursors.reserve(m_matches.size() - 1);
+    for (const Searcher::Match &match : m_matches) {
+        if (match.offset != m_cursor)
+            m_cursors.push_back(match.offset);
+    }
+
+    m_view->setStatus(QString("%1 cursors").arg(m_cursors.size() + 1));
+    ensureCursorVisible();
+    m_view->setCursorPosition(m_cursor);
+    m_view->update();
+}
+
+void
+TextEdit::clearCursors(void)
+{
+    if (m_cursors.empty())
+        return;
+    m_cursors.clear();
+    m_view->update();
+}
+
+void
+TextEdit::insertText(const QString &text)
+{
+    const QByteArray utf8 = text.toUtf8();
+    if (utf8.isEmpty() || !isEditable())
+        return;
+    if (!m_cursors.empty()) {
+        return editCursors(
+            [](size_t cursor) {
+                return std::make_pair(cursor, cursor);
+            },
+            std::string_view(utf8.constData(), utf8.size()));
+    }
+
+    const size_t line = m_document.lineOf(m_cursor);
+    const size_t added = utf8.count('\n');
+    indexRanges({ { m_cursor, m_cursor } }, -1);
+    m_document.insert(m_cursor, std::string_view(utf8.constData(), utf8.size()));
+    indexRanges({ { m_cursor, m_cursor + utf8.size() } }, 1);
+    m_undo.recordInsert(m_cursor, utf8.size());
+    if (m_undoFile)
+        m_undoFile->touch();
+    editLines(line, 0, added);
+    invalidateSearch();
+    m_view->invalidate(m_cursor);
+    m_cursor += utf8.size();
+
+    updateScrollBar();
+    ensureCursorVisible();
+    m_view->setCursorPosition(m_cursor);
+}
+
+void
+TextEdit::deleteBackward(void)
+{
+    if (!m_cursors.empty()) {
+        return editCursors(
+            [this](size_t cursor) {
+                return std::make_pair(previousCodepoint(cursor), cursor);
+            },
+            {});
+    }
+    if (m_cursor == 0)
+        return;
+    const size_t pos = previousCodepoint(m_cursor);
+    removeText(pos, m_cursor - pos);
+}
+
+void
+TextEdit::deleteForward(void)
+{
+    if (!m_cursors.empty()) {
+        return editCursors(
+            [this](size_t cursor) {
+                return std::make_pair(cursor, nextCodepoint(cursor));
+            },
+            {});
+    }
+    if (m_cursor >= m_document.size())
+        return;
+    removeText(m_cursor, nextCodepoint(m_cursor) - m_cursor);
+}
+
+void
+TextEdit::undo(void)
+{
+    moveInHistory(&UndoTree::undo);
+}
+
+void
+TextEdit::redo(void)
+{
+    moveInHistory(&UndoTree::redo);
+}
+
+void
+TextEdit::undoEarlier(void)
+{
+    moveInHistory(&UndoTree::earlier);
+}
+
+void
+TextEdit::undoLater(void)
+{
+    moveInHistory(&UndoTree::later);
+}
+
+void
+TextEdit::search(const QString &pattern, size_t from)
+{
+    cancelSearch();
+    m_matches.clear();
+    m_matchesStale = false;
+    m_searchPattern = pattern;
+    m_searchFrom = from;
+    m_searchJump = true;
+    m_view->setMatches(&m_matches);
+    m_view->setStatus({});
+    if (pattern.isEmpty())
+        return;
+
+    m_searcher = new Searcher(pattern, m_document.snapshot(), this);
+    if (!m_searcher->isValid()) {
+        m_view->setStatus(m_searcher->errorString());
+        cancelSearch();
+        return;
+    }
+
+    connect(m_searcher, &Searcher::matchesFound, this, [=](const Searcher::matches_t &matches) {
+        const auto first = m_matches.insert(m_matches.end(), matches.begin(), matches.end());
+        /* matches arrive in document order, the first one after from is final once it is in */
+        if (m_searchJump) {
+            auto it = std::find_if(first, m_matches.end(), [=](const Searcher::Match &match) {
+                return match.offset > m_searchFrom;
+            });
+            if (it != m_matches.end()) {
+                m_searchJump = false;
+                setCursorPosition(it->offset);
+            }
+        }
+        m_view->setStatus(QString("%1 matches...").arg(m_matches.size()));
+        m_view->update();
+        emit searchProgress(m_matches.size(), false);
+    });
+    connect(m_searcher, &Searcher::finished, this, [=](size_t count) {
+        /* nothing after from, wrap around to the first match */
+        if (m_searchJump && !m_matches.empty())
+            setCursorPosition(m_matches.front().offset);
+        m_searchJump = false;
+        m_view->setStatus(count ? QString("%1 matches").arg(count) : QString("no matches"));
+        emit searchProgress(count, true);
+        m_searcher->deleteLater();
+        m_searcher = nullptr;
+    });
+    m_searcher->start();
+}
+
+void
+TextEdit::searchNext(bool backward)
+{
+    if (m_searchPattern.isEmpty())
+        return;
+    if (m_matchesStale)
+        return search(m_searchPattern, m_cursor);
+    if (m_matches.empty())
+        return;
+
+    auto it = m_matches.begin();
+    if (backward) {
+        it = std::lower_bound(m_matches.begin(), m_matches.end(), m_cursor,
+                              [](const Searcher::Match &match, size_t pos) {
+                                  return match.offset < pos;
+                              });
+        if (it == m_matches.begin())
+            it = m_matches.end();
+        --it;
+    } else {
+        it = std::upper_bound(m_matches.begin(), m_matches.end(), m_cursor,
+                              [](size_t pos, const Searcher::Match &match) {
+                                  return pos < match.offset;
+                              });
+        if (it == m_matches.end())
+            it = m_matches.begin();
+    }
+    setCursorPosition(it->offset);
+    m_view->setStatus(QString("%1/%2").arg(it - m_matches.begin() + 1).arg(m_matches.size()));
+}
+
+void
+TextEdit::cancelSearch(void)
+{
+    /* deleting the searcher waits for the chunks in flight, which stop at the next line */
+    delete m_searcher;
+    m_searcher = nullptr;
+}
+
+void
+TextEdit::grep(const QString &pattern, const QString &root)
+{
+    cancelLoading();
+    cancelSearch();
+    cancelGrep();
+    unindexDocument();
+    delete m_undoFile;
+    m_undoFile = nullptr;
+    m_matches.clear();
+    m_searchPattern.clear();
+    m_results.clear();
+    m_pendingLine = PieceTable::npos;
+    m_encoding.reset();
+
+    /* results only repeat words of the files they are from */
+    m_wordsIndexed = false;
+    m_document.setOriginal(std::string());
+    m_filePath.clear();
+    m_loadState = LoadState::Results;
+    m_resultsRoot = root;
+    m_cursor = 0;
+    m_cursors.clear();
+    m_highlighter.reset();
+    m_folds.clear();
+    m_undo.clear();
+    m_view->setHighlighter(nullptr);
+    updateScrollBar();
+    verticalScrollBar()->setValue(0);
+    m_view->invalidate();
+    m_view->setCursorPosition(m_cursor);
+
+    m_grep = new ProjectSearcher(pattern, root, this);
+    if (!m_grep->isValid()) {
+        m_view->setStatus(m_grep->errorString());
+        cancelGrep();
+        return;
+    }
+    m_view->setStatus("searching...");
+
+    connect(m_grep, &ProjectSearcher::matchesFound, this,
+            [=](const ProjectSearcher::matches_t &matches) {
+                /* results are appended like the chunks of a streamed load, one line each */
+                QByteArray lines;
+                for (const ProjectSearcher::Match &match : matches) {
+                    lines += QString("%1:%2:%3: %4\n")
+                                 .arg(match.path, QString::number(match.line + 1),
+                                      QString::number(match.column + 1), match.text)
+                                 .toUtf8();
+                }
+                const size_t end = m_document.size();
+                const std::string_view text(lines.constData(), lines.size());
+                m_document.appendOriginal(text, TextMetrics::measure(text));
+                m_results.insert(m_results.end(), matches.begin(), matches.end());
+                updateScrollBar();
+                m_view->invalidate(end);
+                m_view->setStatus(QString("%1 matches...").arg(m_results.size()));
+            });
+    connect(m_grep, &ProjectSearcher::finished, this, [=](size_t files, size_t count) {
+        m_view->setStatus(QString("%1 matches in %2 files").arg(count).arg(files));
+        m_grep->deleteLater();
+        m_grep = nullptr;
+    });
+    m_grep->start();
+}
+
+void
+TextEdit::cancelGrep(void)
+{
+    /* deleting the searcher waits for the files being searched */
+    delete m_grep;
+    m_grep = nullptr;
 }
 
 void
 TextEdit::keyPressEvent(QKeyEvent *event)
 {
+    const qint64 key = resolveKey(event->key());
+    if (m_recording) {
+        /* q in Normal mode ends the recording rather than being recorded */
+        if (key == Key_Q && Editor::getInstance()->mode() == Mode::Normal)
+            return stopRecording();
+        m_macros[m_recording - 'a'].push_back({ key, event->text() });
+    }
+    processKey(key, event->text());
+}
+
+void
+TextEdit::processKey(qint64 key, const QString &text)
+{
+    auto editor = Editor::getInstance();
+
+    switch (key & ~static_cast<qint64>(KeyboardModifierMask)) {
+    case Key_Left:
+        return moveCursorLeft();
+    case Key_Right:
+        return moveCursorRight();
+    case Key_Up:
+        return moveCursorUp();
+    case Key_Down:
+        return moveCursorDown();
+    }
+
+    /* chords with Control are bindings in Insert mode too, they never type text */
+    if (editor->mode() != Mode::Insert || (key & ControlModifier)) {
+        dispatchKey(key);
+        return;
+    }
+
+    switch (key & ~static_cast<qint64>(KeyboardModifierMask)) {
+    case Key_Backspace:
+        return deleteBackward();
+    case Key_Delete:
+        return deleteForward();
+    case Key_Return:
+    case Key_Enter:
+        return insertText("\n");
+    case Key_Tab:
+        return insertText("\t");
+    }
+
+    if (!text.isEmpty() && text.front().isPrint())
+        insertText(text);
+}
+
+void
+TextEdit::startRecording(char name)
+{
+    m_recording = name;
+    m_macros[name - 'a'].clear();
+    m_view->setStatus(QString("recording @%1").arg(name));
+}
+
+void
+TextEdit::stopRecording(void)
+{
+    m_recording = '\0';
+    m_view->setStatus({});
+}
+
+void
+TextEdit::replayMacro(char name, size_t count)
+{
+    if (name == '@')
+        name = m_lastMacro;
+    /* a macro replaying itself would never end */
+    if (name < 'a' || name > 'z' || m_replayDepth >= maxReplayDepth)
+        return;
+    m_lastMacro = name;
+
+    /* copied, the macro may record over itself */
+    const std::vector<Keystroke> keys = m_macros[name - 'a'];
     auto editor = Editor::getInstance();
+    QElapsedTimer timer;
+    timer.start();
+
+    /* nothing is painted or scrolled to until the last key, the view then catches up at once */
+    if (m_replayDepth++ == 0)
+        m_view->setUpdatesEnabled(false);
+    for (size_t i = 0; i < count; i++) {
+        for (const Keystroke &keystroke : keys) {
+            /* Escape never reaches the bindings, KeyFilter handles it ahead of them */
+            if (keystroke.key == Key_Escape)
+                editor->setMode(Mode::Normal);
+            processKey(keystroke.key, keystroke.text);
+        }
+    }
+    if (--m_replayDepth > 0)
+        return;
+    m_view->setUpdatesEnabled(true);
+    updateScrollBar();
+    ensureCursorVisible();
+    m_view->setCursorPosition(m_cursor);
+
+    const qint64 elapsed = std::max<qint64>(timer.elapsed(), 1);
+    const size_t replayed = keys.size() * count;
+    m_view->setStatus(QString("@%1: %2 keys in %3 ms, %4 keys/s")
+                          .arg(name)
+                          .arg(replayed)
+                          .arg(elapsed)
+                          .arg(static_cast<qint64>(replayed * 1000 / elapsed)));
+}
+
+bool
+TextEdit::viewportEvent(QEvent *event)
+{
+    /* let the view paint itself rather than routing its paint events through paintEvent */
+    if (event->type() == QEvent::Paint)
+        return false;
+    return QAbstractScrollArea::viewportEvent(event);
+}
+
+void
+TextEdit::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBar();
+}
+
+void
+TextEdit::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    Q_UNUSED(dy);
+    m_view->setTopRow(verticalScrollBar()->value());
+}
+
+size_t
+TextEdit::lineStart(size_t pos) const
+{
+    return m_document.lineStart(m_document.lineOf(pos));
+}
+
+size_t
+TextEdit::lineEnd(size_t pos) const
+{
+    return m_document.lineEnd(m_document.lineOf(pos));
+}
+
+void
+TextEdit::removeText(size_t pos, size_t length)
+{
+    if (!isEditable())
+        return;
+    const size_t line = m_document.lineOf(pos);
+    const size_t removed = m_document.lineOf(pos + length) - line;
+    m_undo.recordRemove(pos, length);
+    indexRanges({ { pos, pos + length } }, -1);
+    m_document.remove(pos, length);
+    indexRanges({ { pos, pos } }, 1);
+    if (m_undoFile)
+        m_undoFile->touch();
+    editLines(line, removed, 0);
+    invalidateSearch();
+    m_view->invalidate(pos);
+    if (m_cursor >= pos + length)
+        m_cursor -= length;
+    else if (m_cursor > pos)
+        m_cursor = pos;
+
+    updateScrollBar();
+    ensureCursorVisible();
+    m_view->setCursorPosition(m_cursor);
+}
+
+void
+TextEdit::editCursors(const range_t &range, std::string_view text)
+{
+    if (!isEditable())
+        return;
+
+    /* the primary cursor is edited along with the others and found again by its index */
+    std::vector<size_t> cursors = m_cursors;
+    const auto primary = std::lower_bound(cursors.begin(), cursors.end(), m_cursor);
+    const size_t index = primary - cursors.begin();
+    cursors.insert(primary, m_cursor);
+
+    std::vector<std::pair<size_t, size_t>> ranges;
+    ranges.reserve(cursors.size());
+    for (size_t cursor : cursors) {
+        auto [start, end] = range(cursor);
+        /* neighbouring cursors deleting towards each other share what lies between them */
+        if (!ranges.empty()) {
+            start = std::max(start, ranges.back().second);
+            end = std::max(end, start);
+        }
+        ranges.push_back({ start, end });
+    }
+
+    const size_t line = m_document.lineOf(ranges.front().first);
+    const size_t removed = m_document.lineOf(ranges.back().second) - line;
+
+    /* back to front, so the offsets of the ranges still to be replaced hold */
+    const Piece piece = m_document.store(text);
+    const size_t count = text.empty() ? 0 : 1;
+    indexRanges(ranges, -1);
+    m_undo.beginGroup();
+    for (auto it = ranges.rbegin(); it != ranges.rend(); ++it) {
+        const auto [start, end] = *it;
+        m_undo.recordRemove(start, end - start);
+        m_document.splice(start, end - start, &piece, count);
+        m_undo.recordInsert(start, text.size());
+    }
+    m_undo.endGroup();
+
+    /* each cursor moves by what was inserted and removed before it */
+    std::vector<std::pair<size_t, size_t>> inserted;
+    inserted.reserve(ranges.size());
+    size_t before = 0;
+    size_t gone = 0;
+    for (size_t i = 0; i < ranges.size(); i++) {
+        before += text.size();
+        cursors[i] = ranges[i].first + before - gone;
+        gone += ranges[i].second - ranges[i].first;
+        inserted.push_back({ cursors[i] - text.size(), cursors[i] });
+    }
+    const size_t end = cursors.back();
+    indexRanges(inserted, 1);
+
+    m_cursor = cursors[index];
+    cursors.erase(cursors.begin() + index);
+    /* cursors whose ranges ran into each other are now one */
+    cursors.erase(std::unique(cursors.begin(), cursors.end()), cursors.end());
+    cursors.erase(std::remove(cursors.begin(), cursors.end(), m_cursor), cursors.end());
+    m_cursors = std::move(cursors);
+
+    if (m_undoFile)
+        m_undoFile->touch();
+    editLines(line, removed, m_document.lineOf(end) - line);
+    invalidateSearch();
+    m_view->invalidate(ranges.front().first);
+
+    updateScrollBar();
+    ensureCursorVisible();
+    m_view->setCursorPosition(m_cursor);
+}
+
+void
+TextEdit::spliceText(size_t pos, size_t length, const Piece *pieces, size_t count)
+{
+    const size_t line = m_document.lineOf(pos);
+    const size_t removed = m_document.lineOf(pos + length) - line;
+    indexRanges({ { pos, pos + length } }, -1);
+    m_document.splice(pos, length, pieces, count);
+
+    size_t added = 0;
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        const std::string_view text = m_document.view(pieces[i]);
+        added += TextMetrics::measure(text).newlines;
+        bytes += text.size();
+    }
+    indexRanges({ { pos, pos + bytes } }, 1);
+    editLines(line, removed, added);
+    invalidateSearch();
+    m_view->invalidate(pos);
+}
+
+void
+TextEdit::moveInHistory(size_t (UndoTree::*move)(const UndoTree::splice_t &))
+{
+    if (!isEditable())
+        return;
+    /* the extra cursors would no longer line up with the document */
+    clearCursors();
+    /* the history of earlier sessions is only read once it is needed */
+    if (m_undoFile && !m_undoFile->isLoaded())
+        m_undoFile->load();
+    const size_t changed =
+        (m_undo.*move)([this](size_t pos, size_t length, const Piece *pieces, size_t count) {
+            spliceText(pos, length, pieces, count);
+        });
+    if (changed == UndoTree::npos)
+        return;
+    m_cursor = std::min(changed, m_document.size());
+    updateScrollBar();
+    ensureCursorVisible();
+    m_view->setCursorPosition(m_cursor);
+}
+
+void
+TextEdit::editLines(size_t line, size_t removed, size_t added)
+{
+    m_highlighter.edit(line, removed, added);
+    if (m_folds.edit(line, removed, added))
+        m_view->relayout();
+}
+
+void
+TextEdit::foldLines(size_t first, size_t last)
+{
+    const size_t top = m_folds.lineOfRow(m_view->topRow());
+    m_folds.fold(first, last);
+    updateFolds(top);
+}
+
+void
+TextEdit::closeFold(void)
+{
+    const size_t line = cursorLine();
+    std::pair<size_t, size_t> range = Folds::markerRange(m_document, line);
+    if (range.first == PieceTable::npos)
+        range = Folds::indentRange(m_document, line);
+    if (range.first == PieceTable::npos)
+        return m_view->setStatus("nothing to fold");
+    foldLines(range.first, range.second);
+}
+
+void
+TextEdit::openFold(void)
+{
+    const size_t top = m_folds.lineOfRow(m_view->topRow());
+    if (m_folds.unfold(cursorLine()))
+        updateFolds(top);
+}
+
+void
+TextEdit::updateFolds(size_t topLine)
+{
+    /* a cursor on a line that got hidden goes to the line showing it */
+    const Folds::Fold *fold = m_folds.foldAt(cursorLine());
+    if (fold && fold->first != cursorLine())
+        m_cursor = m_document.lineStart(fold->first);
+
+    /* the line at the top stays there whatever folded or unfolded above it */
+    m_view->relayout();
+    updateScrollBar();
+    verticalScrollBar()->setValue(static_cast<int>(m_folds.rowOfLine(topLine)));
+    ensureCursorVisible();
+    m_view->setCursorPosition(m_cursor);
+}
+
+size_t
+TextEdit::rowMotion(size_t pos, size_t count, bool up) const
+{
+    const size_t line = m_document.lineOf(pos);
+    const size_t row = m_folds.rowOfLine(line);
+    if (up) {
+        const size_t target = m_folds.lineOfRow(row - std::min(row, count));
+        return m_motion.up(pos, line - target, columnOf(pos));
+    }
+    return m_motion.down(pos, m_folds.lineOfRow(row + count) - line, columnOf(pos));
+}
+
+size_t
+TextEdit::wordBoundary(size_t pos, bool backward) const
+{
+    /* a word longer than the index keeps need not be found whole, only known to be too long */
+    size_t boundary = pos;
+    size_t left = WordIndex::maxLength + 1;
+    m_document.scan(pos, backward, [&](std::string_view text, size_t offset) {
+        if (backward) {
+            for (size_t i = text.size(); i-- > 0;) {
+                if (left-- == 0 || !WordIndex::isWordByte(text[i]))
+                    return false;
+                boundary = offset + i;
+            }
+        } else {
+            for (size_t i = 0; i < text.size(); i++) {
+                if (left-- == 0 || !WordIndex::isWordByte(text[i]))
+                    return false;
+                boundary = offset + i + 1;
+            }
+        }
+        return true;
+    });
+    return boundary;
+}
+
+void
+TextEdit::indexRanges(const std::vector<std::pair<size_t, size_t>> &ranges, int delta)
+{
+    if (!m_wordsIndexed)
+        return;
+    /* the words cut or joined at either end are counted whole, ranges sharing one at once */
+    for (size_t i = 0; i < ranges.size();) {
+        const size_t start = wordBoundary(ranges[i].first, true);
+        size_t end = wordBoundary(ranges[i].second, false);
+        while (++i < ranges.size() && wordBoundary(ranges[i].first, true) <= end)
+            end = std::max(end, wordBoundary(ranges[i].second, false));
+        Editor::wordIndex().count(m_document.text(start, end - start), delta);
+    }
+}
+
+void
+TextEdit::unindexDocument(void)
+{
+    if (!m_wordsIndexed)
+        return;
+    /* piece by piece rather than copied whole, the word a piece ends in is carried to the next */
+    WordIndex &index = Editor::wordIndex();
+    std::string carried;
+    m_document.scan(0, false, [&](std::string_view text, size_t) {
+        const size_t head =
+            std::find_if_not(text.begin(), text.end(), WordIndex::isWordByte) - text.begin();
+        /* only whether a long word is too long matters */
+        carried.append(text.substr(0, std::min(head, WordIndex::maxLength + 1)));
+        carried.resize(std::min(carried.size(), WordIndex::maxLength + 1));
+        if (head == text.size())
+            return true;
+        index.count(carried, -1);
+        size_t tail = text.size();
+        while (WordIndex::isWordByte(text[tail - 1]))
+            tail--;
+        index.count(text.substr(head, tail - head), -1);
+        carried.assign(text.substr(tail));
+        return true;
+    });
+    index.count(carried, -1);
+    m_wordsIndexed = false;
+}
+
+void
+TextEdit::complete(bool backward)
+{
+    /* the words before the other cursors need not share the prefix */
+    if (!isEditable() || !m_cursors.empty())
+        return;
 
-    if (editor->mode() != Mode::Insert)
-        handleKeyPress(event->key());
+    /* repeating cycles through the candidates found first, as long as nothing else was typed */
+    if (m_completions.empty() || m_cursor != m_completionEnd) {
+        size_t start = m_cursor;
+        m_document.scan(m_cursor, true, [&](std::string_view text, size_t offset) {
+            for (size_t i = text.size(); i-- > 0;) {
+                if (!WordIndex::isWordByte(text[i]))
+                    return false;
+                start = offset + i;
+            }
+            return true;
+        });
+        if (start == m_cursor)
+            return;
+        const std::string prefix = m_document.text(start, m_cursor - start);
+        m_completions = Editor::wordIndex().complete(prefix, maxCompletions);
+        if (m_completions.empty()) {
+            m_view->setStatus("no completions");
+            return;
+        }
+        /* the prefix typed comes last, cycling past the candidates brings it back */
+        m_completions.push_back(prefix);
+        m_completion = m_completions.size() - 1;
+        m_completionStart = start;
+    }
+
+    const size_t candidates = m_completions.size();
+    m_completion = (m_completion + (backward ? candidates - 1 : 1)) % candidates;
+    removeText(m_completionStart, m_cursor - m_completionStart);
+    insertText(QString::fromStdString(m_completions[m_completion]));
+    m_completionEnd = m_cursor;
+    if (m_completion + 1 < candidates)
+        m_view->setStatus(QString("%1 of %2").arg(m_completion + 1).arg(candidates - 1));
     else
-        QTextEdit::keyPressEvent(event);
+        m_view->setStatus("back at original");
+}
+
+void
+TextEdit::invalidateSearch(void)
+{
+    if (m_searchPattern.isEmpty() || m_matchesStale)
+        return;
+    cancelSearch();
+    m_matches.clear();
+    m_matchesStale = true;
+    m_view->setStatus({});
+    m_view->update();
+}
+
+void
+TextEdit::openResult(void)
+{
+    const size_t line = cursorLine();
+    if (m_loadState != LoadState::Results || line >= m_results.size())
+        return;
+    const ProjectSearcher::Match &match = m_results[line];
+    emit resultActivated(QDir(m_resultsRoot).filePath(match.path), match.line, match.column);
+}
+
+size_t
+TextEdit::columnOf(size_t pos) const
+{
+    const size_t start = lineStart(pos);
+    return m_document.metricsBefore(pos).codepoints - m_document.metricsBefore(start).codepoints;
+}
+
+size_t
+TextEdit::previousCodepoint(size_t pos) const
+{
+    if (pos == 0)
+        return 0;
+    pos--;
+    while (pos > 0 && isContinuationByte(m_document.at(pos)))
+        pos--;
+    return pos;
+}
+
+size_t
+TextEdit::nextCodepoint(size_t pos) const
+{
+    if (pos >= m_document.size())
+        return m_document.size();
+    pos++;
+    while (pos < m_document.size() && isContinuationByte(m_document.at(pos)))
+        pos++;
+    return pos;
+}
+
+size_t
+TextEdit::restingPosition(size_t pos) const
+{
+    if (pos > lineStart(pos) && pos == lineEnd(pos))
+        return previousCodepoint(pos);
+    return pos;
+}
+
+void
+TextEdit::moveCursors(const std::function<size_t(size_t pos)> &motion)
+{
+    /* in Normal mode cursors rest on a character, only operators reach the end of a line */
+    const Mode mode = Editor::getInstance()->mode();
+    auto move = [&](size_t pos) {
+        return mode == Mode::Normal ? restingPosition(motion(pos)) : motion(pos);
+    };
+    m_cursor = move(m_cursor);
+    if (mode == Mode::VisualBlock) {
+        updateBlock();
+    } else if (!m_cursors.empty()) {
+        for (size_t &cursor : m_cursors)
+            cursor = move(cursor);
+        /* motions keep the cursors in order, the ones that met are now one */
+        std::sort(m_cursors.begin(), m_cursors.end());
+        m_cursors.erase(std::unique(m_cursors.begin(), m_cursors.end()), m_cursors.end());
+        m_cursors.erase(std::remove(m_cursors.begin(), m_cursors.end(), m_cursor),
+                        m_cursors.end());
+        m_view->update();
+    }
+    ensureCursorVisible();
+    m_view->setCursorPosition(m_cursor);
+}
+
+void
+TextEdit::addMotion(QList<QKeyCombination> keys, MotionKind kind,
+                    std::function<size_t(size_t pos, size_t count)> motion)
+{
+    for (Mode mode : { Mode::Normal, Mode::VisualBlock }) {
+        addBinding(keys, mode, [=]() {
+            const size_t count = std::max<size_t>(this->count(), 1);
+            moveCursors([&](size_t pos) {
+                return motion(pos, count);
+            });
+        });
+    }
+    /* zf followed by the motion folds the lines it moves over */
+    addBinding(QList<QKeyCombination>{ Key_Z, Key_F } + keys, Mode::Normal, [=]() {
+        const size_t target = motion(m_cursor, std::max<size_t>(this->count(), 1));
+        const size_t line = cursorLine();
+        foldLines(std::min(line, m_document.lineOf(target)),
+                  std::max(line, m_document.lineOf(target)));
+    });
+    /* an operator followed by the motion applies to the text it moves over */
+    for (Operator op : { Operator::Delete, Operator::Change, Operator::Yank }) {
+        addBinding(QList<QKeyCombination>{ operatorKey(op) } + keys, Mode::Normal, [=]() {
+            const size_t count = std::max<size_t>(this->count(), 1);
+            operate(op, kind, [&](size_t pos) {
+                return motion(pos, count);
+            });
+        });
+    }
+}
+
+Qt::Key
+TextEdit::operatorKey(Operator op)
+{
+    switch (op) {
+    case Operator::Delete:
+        return Key_D;
+    case Operator::Change:
+        return Key_C;
+    case Operator::Yank:
+        return Key_Y;
+    }
+    return Key_unknown;
+}
+
+std::pair<size_t, size_t>
+TextEdit::operatorRange(Operator op, MotionKind kind, size_t pos, size_t target,
+                        bool *linewise) const
+{
+    size_t start = std::min(pos, target);
+    size_t end = std::max(pos, target);
+
+    /*
+     * an exclusive motion ending at the start of a line stops at the end of the one before, and
+     * becomes linewise if it started at or before the first non-blank of its line
+     */
+    if (kind == MotionKind::Exclusive && end > start && end == lineStart(end) &&
+        m_document.lineOf(end) > m_document.lineOf(start)) {
+        end--;
+        if (start <= m_motion.line(m_document.lineOf(start)))
+            kind = MotionKind::Linewise;
+    }
+    if (linewise)
+        *linewise = kind == MotionKind::Linewise;
+
+    switch (kind) {
+    case MotionKind::Exclusive:
+        break;
+    case MotionKind::Inclusive:
+        end = nextCodepoint(end);
+        break;
+    case MotionKind::Word: {
+        /* the last word moved over ending its line ends the range rather than the next word */
+        const size_t line = m_document.lineOf(end);
+        if (line > m_document.lineOf(start) && end == m_motion.line(line))
+            end = std::max(start, m_document.lineEnd(line - 1));
+        /* cw changes a word but not the blanks after it */
+        auto isBlank = [this](size_t pos) {
+            const char c = m_document.at(pos);
+            return c == ' ' || c == '\t' || c == '\n';
+        };
+        if (op == Operator::Change && start < end && !isBlank(start)) {
+            while (end > start && isBlank(end - 1))
+                end--;
+        }
+        break;
+    }
+    case MotionKind::Linewise:
+        start = lineStart(start);
+        end = lineEnd(end);
+        /* deleting takes the newline along, the one before the lines if they end the document */
+        if (op == Operator::Delete) {
+            if (end < m_document.size())
+                end++;
+            else if (start > 0)
+                start--;
+        }
+        break;
+    }
+    return { start, end };
+}
+
+void
+TextEdit::operate(Operator op, MotionKind kind, const std::function<size_t(size_t pos)> &motion)
+{
+    if (op != Operator::Yank && !isEditable())
+        return;
+
+    const size_t target = motion(m_cursor);
+    bool linewise = false;
+    const auto [start, end] = operatorRange(op, kind, m_cursor, target, &linewise);
+    /* the register gets whole lines whatever the operator leaves of them */
+    Editor::Register &reg = Editor::getInstance()->yankRegister();
+    const auto [first, last] = linewise ? operatorRange(Operator::Yank, kind, m_cursor, target)
+                                        : std::make_pair(start, end);
+    reg.text = m_document.text(first, last - first);
+    reg.linewise = linewise;
+    if (linewise)
+        reg.text.push_back('\n');
+
+    if (op == Operator::Yank) {
+        clearCursors();
+        setCursorPosition(std::min(m_cursor, target));
+        return;
+    }
+
+    /* the change and the text typed after it are undone as one step */
+    if (op == Operator::Change)
+        Editor::getInstance()->setMode(Mode::Insert);
+    if (m_cursors.empty()) {
+        if (end > start)
+            removeText(start, end - start);
+    } else {
+        editCursors(
+            [&](size_t cursor) {
+                return operatorRange(op, kind, cursor, motion(cursor));
+            },
+            {});
+    }
+    if (op == Operator::Delete && linewise)
+        setCursorPosition(m_motion.line(cursorLine()));
+}
+
+void
+TextEdit::put(bool before, size_t count)
+{
+    const Editor::Register &reg = Editor::getInstance()->yankRegister();
+    if (reg.text.empty() || !isEditable())
+        return;
+
+    std::string text;
+    text.reserve(reg.text.size() * count);
+    for (size_t i = 0; i < count; i++)
+        text += reg.text;
+    /* lines go in after the newline ending the cursor line, which the last line may not have */
+    if (reg.linewise && !before) {
+        text.pop_back();
+        text.insert(text.begin(), '\n');
+    }
+
+    editCursors(
+        [&](size_t cursor) {
+            size_t pos = cursor;
+            if (reg.linewise)
+                pos = before ? lineStart(cursor) : lineEnd(cursor);
+            else if (!before && cursor < lineEnd(cursor))
+                pos = nextCodepoint(cursor);
+            return std::make_pair(pos, pos);
+        },
+        text);
+
+    /* as in vim the cursor ends on the first line put, or on the last character */
+    if (m_cursors.empty()) {
+        const size_t start = m_cursor - text.size() + (reg.linewise && !before);
+        setCursorPosition(reg.linewise ? m_motion.line(m_document.lineOf(start))
+                                       : previousCodepoint(m_cursor));
+    }
+}
+
+void
+TextEdit::updateBlock(void)
+{
+    /* lines too short to reach the column of the primary cursor are left out, as in vim */
+    const size_t column = columnOf(m_cursor);
+    const size_t line = cursorLine();
+    const size_t anchor = m_document.lineOf(m_blockAnchor);
+    m_cursors.clear();
+    for (size_t i = std::min(line, anchor); i <= std::max(line, anchor); i++) {
+        if (i == line)
+            continue;
+        const size_t pos = m_motion.column(m_document.lineStart(i), column);
+        if (columnOf(pos) == column)
+            m_cursors.push_back(pos);
+    }
+    m_view->update();
+}
+
+void
+TextEdit::moveCursorLeft(void)
+{
+    moveCursors([this](size_t pos) {
+        return m_motion.left(pos, 1);
+    });
+}
+
+void
+TextEdit::moveCursorRight(void)
+{
+    moveCursors([this](size_t pos) {
+        return m_motion.column(pos, 1);
+    });
+}
+
+void
+TextEdit::moveCursorUp(void)
+{
+    moveCursors([this](size_t pos) {
+        return rowMotion(pos, 1, true);
+    });
+}
+
+void
+TextEdit::moveCursorDown(void)
+{
+    moveCursors([this](size_t pos) {
+        return rowMotion(pos, 1, false);
+    });
+}
+
+void
+TextEdit::ensureCursorVisible(void)
+{
+    if (m_replayDepth > 0)
+        return;
+    const size_t rows = std::max(1, visibleLineCount() - 1);
+    const size_t line = cursorLine();
+    auto *scrollBar = verticalScrollBar();
+
+    /* jumping to a line hidden by a fold opens it */
+    const Folds::Fold *fold = m_folds.foldAt(line);
+    if (fold && fold->first != line) {
+        const size_t top = m_folds.lineOfRow(m_view->topRow());
+        m_folds.unfold(line);
+        m_view->relayout();
+        updateScrollBar();
+        scrollBar->setValue(static_cast<int>(m_folds.rowOfLine(top)));
+    }
+
+    const size_t row = m_folds.rowOfLine(line);
+    const size_t topRow = m_view->topRow();
+    if (row < topRow)
+        scrollBar->setValue(static_cast<int>(row));
+    else if (row >= topRow + rows)
+        scrollBar->setValue(static_cast<int>(row - rows + 1));
+}
+
+void
+TextEdit::updateScrollBar(void)
+{
+    if (m_replayDepth > 0)
+        return;
+    auto *scrollBar = verticalScrollBar();
+    /* a lazily indexed document only knows its line count once it has been read to the end */
+    const size_t rows = m_document.estimatedLineCount() - m_folds.hiddenLines();
+    scrollBar->setRange(0, static_cast<int>(rows - 1));
+    scrollBar->setPageStep(visibleLineCount());
+}
+
+int
+TextEdit::visibleLineCount(void) const
+{
+    return m_view->visibleLineCount();
 }
 
 } // namespace pico
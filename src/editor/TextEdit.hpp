@@ -1,21 +1,427 @@
 #pragma once
 
+#include "editor/FileLoader.hpp"
+#include "editor/FileSaver.hpp"
+#include "editor/Folds.hpp"
+#include "editor/Highlighter.hpp"
 #include "editor/KeyListener.hpp"
+#include "editor/Motion.hpp"
 #include "editor/PicoWidget.hpp"
-#include <QTextEdit>
+#include "editor/PieceTable.hpp"
+#include "editor/ProjectSearcher.hpp"
+#include "editor/Searcher.hpp"
+#include "editor/TextView.hpp"
+#include "editor/UndoFile.hpp"
+#include "editor/UndoTree.hpp"
+#include <QAbstractScrollArea>
+
+#include <array>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace pico {
 
-class TextEdit : public QTextEdit, public PicoWidget
+/**
+ * Editor for a PieceTable, painting is left to a TextView viewport which only ever fetches the
+ * visible lines from the document
+ */
+class TextEdit : public QAbstractScrollArea, public PicoWidget
 {
     Q_OBJECT
 
 public:
     explicit TextEdit(QWidget *parent = nullptr);
 
+    ~TextEdit();
+
+    PieceTable &
+    document(void);
+
+    const TextView &
+    view(void) const;
+
+    /* open path, files below the mapping threshold are streamed in on a FileLoader */
+    bool
+    openFile(const QString &path);
+
+    bool
+    isLoading(void) const;
+
+    /* stop a streamed load, what has arrived so far stays visible but read-only */
+    void
+    cancelLoading(void);
+
+    /* false while the document is loading or only partially loaded */
+    bool
+    isEditable(void) const;
+
+    /*
+     * save a snapshot of the document to path, or to the opened file when path is empty, on a
+     * FileSaver, the result is reported through Editor::saved
+     */
+    bool
+    save(const QString &path = {});
+
+    bool
+    isSaving(void) const;
+
+    const QString &
+    filePath(void) const;
+
+    size_t
+    cursorPosition(void) const;
+
+    void
+    setCursorPosition(size_t pos);
+
+    size_t
+    cursorLine(void) const;
+
+    /* column of the cursor in codepoints */
+    size_t
+    cursorColumn(void) const;
+
+    /* move to column, in codepoints, of line, once it has been loaded if the file is loading */
+    void
+    gotoLine(size_t line, size_t column = 0);
+
+    /* cursors besides the primary one, sorted by offset, edits apply at every cursor */
+    const std::vector<size_t> &
+    cursors(void) const;
+
+    /* put a cursor on every search match found, the primary one on the first after it */
+    void
+    addCursorsAtMatches(void);
+
+    /* leave only the primary cursor */
+    void
+    clearCursors(void);
+
+    void
+    insertText(const QString &text);
+
+    void
+    deleteBackward(void);
+
+    void
+    deleteForward(void);
+
+    void
+    undo(void);
+
+    void
+    redo(void);
+
+    /* move to the state of the document before or after the current one in time */
+    void
+    undoEarlier(void);
+
+    void
+    undoLater(void);
+
+    /*
+     * search for pattern in the background, matches stream in and the cursor moves to the first
+     * one after from as soon as it has arrived
+     */
+    void
+    search(const QString &pattern, size_t from);
+
+    /* move to the next match after the cursor, or the previous one, wrapping around */
+    void
+    searchNext(bool backward = false);
+
+    void
+    cancelSearch(void);
+
+    /*
+     * replace the document with a read-only listing of the lines matching pattern in the files
+     * below root, streamed in from a ProjectSearcher, Enter on a listed line activates it
+     */
+    void
+    grep(const QString &pattern, const QString &root);
+
+    void
+    cancelGrep(void);
+
+signals:
+    void
+    loadProgress(qint64 loaded, qint64 total);
+
+    void
+    searchProgress(size_t count, bool finished);
+
+    /* Enter was pressed on a line of a grep listing */
+    void
+    resultActivated(const QString &path, size_t line, size_t column);
+
 protected:
+    /* records the key while a macro is being recorded */
     void
     keyPressEvent(QKeyEvent *event) override;
+
+    bool
+    viewportEvent(QEvent *event) override;
+
+    void
+    resizeEvent(QResizeEvent *event) override;
+
+    void
+    scrollContentsBy(int dx, int dy) override;
+
+private: /* types */
+    /* the range an edit replaces for a cursor */
+    using range_t = std::function<std::pair<size_t, size_t>(size_t cursor)>;
+
+    /* how an operator treats the text a motion moves over */
+    enum class MotionKind {
+        Exclusive,
+        Inclusive,
+        Linewise,
+        /* exclusive, but stopping at the end of a line the last word ends, c stops like e */
+        Word,
+    };
+
+    enum class Operator {
+        Delete,
+        Change,
+        Yank,
+    };
+
+    /* a key of a macro, with the modifiers it was typed with and the text it typed */
+    struct Keystroke {
+        qint64 key;
+        QString text;
+    };
+
+    enum class LoadState {
+        Loaded,
+        Loading,
+        Partial,
+        /* a read-only grep listing */
+        Results,
+    };
+
+private:
+    /* handle a key resolved with its modifiers, typed or replayed from a macro */
+    void
+    processKey(qint64 key, const QString &text);
+
+    /* record the keys typed into the macro name, until q is typed in Normal mode */
+    void
+    startRecording(char name);
+
+    void
+    stopRecording(void);
+
+    /*
+     * run the keys of macro name count times straight through processKey, @ being the macro run
+     * last, the view is only repainted once they have all run
+     */
+    void
+    replayMacro(char name, size_t count);
+
+    /* offset of the first byte of the line containing pos */
+    size_t
+    lineStart(size_t pos) const;
+
+    /* offset of the newline ending the line containing pos, or the document size */
+    size_t
+    lineEnd(size_t pos) const;
+
+    void
+    removeText(size_t pos, size_t length);
+
+    /*
+     * replace the range of every cursor with text as one undo step and one repaint, the text is
+     * stored once and each cursor ends up after its copy
+     */
+    void
+    editCursors(const range_t &range, std::string_view text);
+
+    /* replace length bytes at pos with pieces of the document's buffers, for undo and redo */
+    void
+    spliceText(size_t pos, size_t length, const Piece *pieces, size_t count);
+
+    /* undo or redo through move, leaving the cursor where the document changed */
+    void
+    moveInHistory(size_t (UndoTree::*move)(const UndoTree::splice_t &));
+
+    /* lines from line on changed, removed lines after it replaced by added ones */
+    void
+    editLines(size_t line, size_t removed, size_t added);
+
+    /* fold lines first to last, or the block at the cursor by its markers or indentation */
+    void
+    foldLines(size_t first, size_t last);
+
+    void
+    closeFold(void);
+
+    void
+    openFold(void);
+
+    /* lay out the rows again once the folds changed, keeping topLine at the top */
+    void
+    updateFolds(size_t topLine);
+
+    /* column of the line count rows below or above pos, a closed fold being a single row */
+    size_t
+    rowMotion(size_t pos, size_t count, bool up) const;
+
+    /* start of the word pos is in or after when backward, else its end */
+    size_t
+    wordBoundary(size_t pos, bool backward) const;
+
+    /* count the words overlapping the sorted ranges into the word index of the editor, or out */
+    void
+    indexRanges(const std::vector<std::pair<size_t, size_t>> &ranges, int delta);
+
+    /* take the words of the whole document out of the word index, before it is replaced */
+    void
+    unindexDocument(void);
+
+    /* complete the word before the cursor from the words of every buffer, again to cycle */
+    void
+    complete(bool backward);
+
+    /* the document changed, matches found so far no longer line up with it */
+    void
+    invalidateSearch(void);
+
+    /* emit resultActivated for the grep result on the cursor line */
+    void
+    openResult(void);
+
+    /* column of pos in codepoints */
+    size_t
+    columnOf(size_t pos) const;
+
+    /* start of the codepoint before pos, or the one after it */
+    size_t
+    previousCodepoint(size_t pos) const;
+
+    size_t
+    nextCodepoint(size_t pos) const;
+
+    /* pos, or the last character of its line when pos is the end of a line that has one */
+    size_t
+    restingPosition(size_t pos) const;
+
+    /* move every cursor to where motion takes it, in VisualBlock only the primary one moves */
+    void
+    moveCursors(const std::function<size_t(size_t pos)> &motion);
+
+    /*
+     * bind keys to a motion in Normal and VisualBlock mode and after each operator, the motion is
+     * given the count typed or 1
+     */
+    void
+    addMotion(QList<QKeyCombination> keys, MotionKind kind,
+              std::function<size_t(size_t pos, size_t count)> motion);
+
+    /* key starting op, doubled it applies to count lines */
+    static Qt::Key
+    operatorKey(Operator op);
+
+    /* the range op applies to for a cursor at pos moved to target, as vim has it */
+    std::pair<size_t, size_t>
+    operatorRange(Operator op, MotionKind kind, size_t pos, size_t target,
+                  bool *linewise = nullptr) const;
+
+    /*
+     * apply op to the text motion moves over from every cursor as a single edit, what the primary
+     * cursor moved over goes to the register
+     */
+    void
+    operate(Operator op, MotionKind kind, const std::function<size_t(size_t pos)> &motion);
+
+    /* put the register count times after every cursor, or before it */
+    void
+    put(bool before, size_t count);
+
+    /* a cursor on each line between the block anchor and the primary cursor, at its column */
+    void
+    updateBlock(void);
+
+    void
+    moveCursorLeft(void);
+
+    void
+    moveCursorRight(void);
+
+    void
+    moveCursorUp(void);
+
+    void
+    moveCursorDown(void);
+
+    void
+    ensureCursorVisible(void);
+
+    void
+    updateScrollBar(void);
+
+    int
+    visibleLineCount(void) const;
+
+private:
+    PieceTable m_document;
+    Highlighter m_highlighter;
+    UndoTree m_undo;
+    Motion m_motion;
+    Folds m_folds;
+    /* persistent history of the opened file */
+    UndoFile *m_undoFile;
+    QString m_filePath;
+    FileLoader *m_loader;
+    LoadState m_loadState;
+    quint64 m_loadId;
+    /* byte order mark of the opened file, saves write it back in its encoding */
+    std::optional<QStringConverter::Encoding> m_encoding;
+    FileSaver *m_saver;
+    /* target of a save requested while another one was still being written */
+    QString m_pendingSave;
+    TextView *m_view;
+    Searcher *m_searcher;
+    QString m_searchPattern;
+    Searcher::matches_t m_matches;
+    size_t m_searchFrom;
+    /* move to the first match after m_searchFrom once it arrives */
+    bool m_searchJump;
+    /* an edit happened since the last search, the next one starts over */
+    bool m_matchesStale;
+    ProjectSearcher *m_grep;
+    QString m_resultsRoot;
+    /* the grep result listed on each line */
+    ProjectSearcher::matches_t m_results;
+    /* line and column to move to once they have been loaded, npos if none */
+    size_t m_pendingLine;
+    size_t m_pendingColumn;
+    /* an undo group is open for the current Insert session */
+    bool m_insertGroup;
+    size_t m_cursor;
+    /* secondary cursors, sorted and never at the primary one */
+    std::vector<size_t> m_cursors;
+    /* where VisualBlock was entered */
+    size_t m_blockAnchor;
+    /* macros by register, a to z */
+    std::array<std::vector<Keystroke>, 26> m_macros;
+    /* register being recorded into, '\0' when not recording */
+    char m_recording;
+    char m_lastMacro;
+    /* macros replaying, they may replay others */
+    unsigned m_replayDepth;
+    /* the words of the document are counted in the word index, edits keep them up to date */
+    bool m_wordsIndexed;
+    /* candidates of the completion in progress, the prefix typed last */
+    std::vector<std::string> m_completions;
+    size_t m_completion;
+    size_t m_completionStart;
+    /* where the last completion left the cursor, completing from there cycles */
+    size_t m_completionEnd;
 };
 
 } // namespace pico
@@ -0,0 +1,418 @@
+#include "TextView.hpp"
+
+#include <QEvent>
+#include <QFontInfo>
+#include <QPaintEvent>
+#include <QPainter>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace pico {
+
+static QString
+displayText(const std::string &bytes)
+{
+    return QString::fromUtf8(bytes.data(), bytes.size()).replace('\t', "    ");
+}
+
+TextView::TextView(const PieceTable &document, QWidget *parent)
+    : QWidget(parent),
+      m_document(document),
+      m_lines(),
+      m_firstRow(0),
+      m_topRow(0),
+      m_cursor(0),
+      m_cursorStyle(CursorStyle::Block),
+      m_cursorRect(),
+      m_glyphs(),
+      m_highlighter(nullptr),
+      m_lexTimer(),
+      m_matches(nullptr),
+      m_cursors(nullptr),
+      m_folds(nullptr),
+      m_status(),
+      m_lineHeight(1),
+      m_advance(0)
+{
+    /* every paint fills its own background, which lets scrolls blit without a clear */
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setCursor(Qt::IBeamCursor);
+    updateFontMetrics();
+
+    /* lines painted with a guessed state are repainted once the lines above them are lexed */
+    m_lexTimer.setSingleShot(true);
+    m_lexTimer.setInterval(0);
+    connect(&m_lexTimer, &QTimer::timeout, this, [this]() {
+        if (m_highlighter == nullptr)
+            return;
+        m_highlighter->lexAhead(lexSlice);
+        if (m_highlighter->lexPending())
+            m_lexTimer.start();
+        else
+            update();
+    });
+}
+
+size_t
+TextView::topRow(void) const
+{
+    return m_topRow;
+}
+
+void
+TextView::setTopRow(size_t row)
+{
+    if (row == m_topRow)
+        return;
+
+    const qint64 delta = static_cast<qint64>(m_topRow) - static_cast<qint64>(row);
+    m_topRow = row;
+    m_cursorRect.translate(0, static_cast<int>(delta * m_lineHeight));
+
+    /* move what is still on screen and only paint the rows scrolled in, unless the status overlay
+     * would be moved along */
+    if (std::abs(delta) < visibleLineCount() && std::floor(m_lineHeight) == m_lineHeight &&
+        m_status.isEmpty())
+        scroll(0, static_cast<int>(delta * m_lineHeight));
+    else
+        update();
+}
+
+void
+TextView::setCursorPosition(size_t pos)
+{
+    update(m_cursorRect);
+    m_cursor = pos;
+
+    size_t row;
+    if (lineAt(pos, &row))
+        update(rowRect(row));
+    else
+        update();
+}
+
+void
+TextView::setCursorStyle(CursorStyle style)
+{
+    if (style == m_cursorStyle)
+        return;
+    m_cursorStyle = style;
+    update(m_cursorRect);
+}
+
+void
+TextView::setHighlighter(Highlighter *highlighter)
+{
+    m_highlighter = highlighter;
+    update();
+}
+
+void
+TextView::setMatches(const Searcher::matches_t *matches)
+{
+    m_matches = matches;
+    update();
+}
+
+void
+TextView::setCursors(const std::vector<size_t> *cursors)
+{
+    m_cursors = cursors;
+    update();
+}
+
+void
+TextView::setFolds(const Folds *folds)
+{
+    m_folds = folds;
+    relayout();
+}
+
+void
+TextView::relayout(void)
+{
+    m_lines.clear();
+    update();
+}
+
+void
+TextView::setStatus(const QString &status)
+{
+    if (status == m_status)
+        return;
+    update(statusRect());
+    m_status = status;
+    update(statusRect());
+}
+
+int
+TextView::visibleLineCount(void) const
+{
+    return static_cast<int>(height() / m_lineHeight) + 1;
+}
+
+void
+TextView::invalidate(size_t pos)
+{
+    size_t first = m_firstRow + m_lines.size();
+    while (!m_lines.empty() && m_lines.back().end >= pos) {
+        m_lines.pop_back();
+        first--;
+    }
+
+    if (first < m_topRow)
+        update();
+    else
+        update(QRect(0, rowRect(first).top(), width(), height()));
+}
+
+const GlyphCache &
+TextView::glyphCache(void) const
+{
+    return m_glyphs;
+}
+
+void
+TextView::paintEvent(QPaintEvent *event)
+{
+    layout();
+
+    QPainter painter(this);
+    const QRect dirty = event->rect();
+    painter.fillRect(dirty, palette().base());
+
+    const size_t firstRow = std::max(0, static_cast<int>(dirty.top() / m_lineHeight));
+    const size_t lastRow = static_cast<size_t>(dirty.bottom() / m_lineHeight);
+    for (size_t row = firstRow; row <= lastRow; row++) {
+        const Line *line = this->line(m_topRow + row);
+        if (line == nullptr)
+            break;
+        const qreal y = row * m_lineHeight;
+        if (line->folded)
+            paintFold(painter, *line, xOf(*line, line->end), y);
+
+        /* with a fixed advance, characters past the right edge are never handed to the shaper */
+        QString text = line->text;
+        if (line->ascii && m_advance > 0)
+            text.truncate(static_cast<int>(width() / m_advance) + 1);
+        /* only the lines painted are highlighted, and only lexed up to them */
+        quint64 style = 0;
+        QList<QTextLayout::FormatRange> formats;
+        if (m_highlighter)
+            formats = m_highlighter->formats(line->index, text, &style);
+
+        if (m_matches)
+            paintMatches(painter, *line, y);
+
+        for (const GlyphCache::Run &run : m_glyphs.runs(text, font(), formats, style)) {
+            painter.setPen(run.color.isValid() ? run.color : palette().text().color());
+            painter.drawGlyphRun(QPointF(0, y), run.glyphs);
+        }
+
+        if (m_cursors)
+            paintCursors(painter, *line, y);
+
+        if (m_cursor < line->start || m_cursor > line->end)
+            continue;
+        m_cursorRect = paintCursor(painter, *line, m_cursor, y);
+    }
+
+    if (!m_status.isEmpty() && dirty.intersects(statusRect())) {
+        painter.fillRect(statusRect(), palette().alternateBase());
+        painter.setPen(palette().text().color());
+        painter.drawText(statusRect(), Qt::AlignCenter, m_status);
+    }
+
+    if (m_highlighter && m_highlighter->lexPending() && !m_lexTimer.isActive())
+        m_lexTimer.start();
+}
+
+void
+TextView::changeEvent(QEvent *event)
+{
+    QWidget::changeEvent(event);
+    if (event->type() == QEvent::FontChange) {
+        updateFontMetrics();
+        m_lines.clear();
+        m_glyphs.clear();
+        update();
+    }
+}
+
+void
+TextView::updateFontMetrics(void)
+{
+    const QFontMetricsF metrics(font());
+    m_lineHeight = metrics.lineSpacing();
+
+    /* fixedPitch is only a hint, make sure narrow and wide glyphs really share one advance */
+    m_advance = 0;
+    const qreal advance = metrics.horizontalAdvance(QLatin1Char('M'));
+    if (QFontInfo(font()).fixedPitch() && metrics.horizontalAdvance(QLatin1Char('i')) == advance &&
+        metrics.horizontalAdvance(QLatin1Char(' ')) == advance)
+        m_advance = advance;
+}
+
+void
+TextView::layout(void)
+{
+    const size_t rows = visibleLineCount();
+    const size_t last = m_topRow + rows + margin;
+
+    /* lines that survived the last invalidate or scroll are kept, only missing ones are fetched */
+    if (m_lines.empty() || m_topRow < m_firstRow || m_topRow > m_firstRow + m_lines.size()) {
+        m_lines.clear();
+        m_firstRow = m_topRow > margin ? m_topRow - margin : 0;
+    }
+    while (m_firstRow + margin < m_topRow && !m_lines.empty()) {
+        m_lines.pop_front();
+        m_firstRow++;
+    }
+    while (m_firstRow + m_lines.size() > last + margin)
+        m_lines.pop_back();
+
+    const bool indexed = m_document.isIndexed();
+    const size_t fetched = m_lines.size();
+    for (size_t row = m_firstRow + m_lines.size(); row < last; row++) {
+        Line line;
+        line.index = m_folds ? m_folds->lineOfRow(row) : row;
+        line.folded = m_folds ? m_folds->hiddenAfter(line.index) : 0;
+        const size_t start = m_document.lineStart(line.index);
+        if (start == PieceTable::npos)
+            break;
+        line.start = start;
+        line.end = m_document.lineEnd(line.index);
+        line.bytes = m_document.text(start, line.end - start);
+        line.text = displayText(line.bytes);
+        line.ascii = std::all_of(line.bytes.begin(), line.bytes.end(), [](char c) {
+            return static_cast<unsigned char>(c) < 0x80;
+        });
+        m_lines.push_back(std::move(line));
+    }
+
+    if (!indexed && m_lines.size() != fetched)
+        emit documentIndexed();
+}
+
+const TextView::Line *
+TextView::line(size_t row) const
+{
+    if (row < m_firstRow || row >= m_firstRow + m_lines.size())
+        return nullptr;
+    return &m_lines[row - m_firstRow];
+}
+
+const TextView::Line *
+TextView::lineAt(size_t pos, size_t *row) const
+{
+    auto it = std::lower_bound(m_lines.begin(), m_lines.end(), pos,
+                               [](const Line &line, size_t value) {
+                                   return line.end < value;
+                               });
+    if (it == m_lines.end() || it->start > pos)
+        return nullptr;
+    if (row)
+        *row = m_firstRow + (it - m_lines.begin());
+    return &*it;
+}
+
+qreal
+TextView::xOf(const Line &line, size_t pos) const
+{
+    const size_t length = pos - line.start;
+    if (line.ascii && m_advance > 0) {
+        const size_t tabs = std::count(line.bytes.begin(), line.bytes.begin() + length, '\t');
+        return (length + tabs * (tabWidth - 1)) * m_advance;
+    }
+    return widthOf(line.bytes.substr(0, length));
+}
+
+qreal
+TextView::widthOf(const std::string &bytes) const
+{
+    if (m_advance > 0 && bytes.size() == 1 && static_cast<unsigned char>(bytes[0]) < 0x80)
+        return (bytes[0] == '\t' ? tabWidth : 1) * m_advance;
+    return QFontMetricsF(font()).horizontalAdvance(displayText(bytes));
+}
+
+QRect
+TextView::rowRect(size_t row) const
+{
+    const qreal y = (static_cast<qreal>(row) - static_cast<qreal>(m_topRow)) * m_lineHeight;
+    return QRectF(0, y, width(), m_lineHeight).toAlignedRect();
+}
+
+QRect
+TextView::statusRect(void) const
+{
+    const int width = QFontMetrics(font()).horizontalAdvance(m_status) + 16;
+    const int height = static_cast<int>(std::ceil(m_lineHeight));
+    return QRect(this->width() - width, this->height() - height, width, height);
+}
+
+void
+TextView::paintMatches(QPainter &painter, const Line &line, qreal y) const
+{
+    /* matches never span lines, the first one on this line is the first one starting on it */
+    auto it = std::lower_bound(m_matches->begin(), m_matches->end(), line.start,
+                               [](const Searcher::Match &match, size_t value) {
+                                   return match.offset < value;
+                               });
+    QColor color = palette().highlight().color();
+    color.setAlpha(96);
+    for (; it != m_matches->end() && it->offset <= line.end; ++it) {
+        const qreal x = xOf(line, it->offset);
+        const qreal end = xOf(line, std::min(it->offset + it->length, line.end));
+        painter.fillRect(QRectF(x, y, std::max<qreal>(end - x, 2), m_lineHeight), color);
+    }
+}
+
+QRect
+TextView::paintCursor(QPainter &painter, const Line &line, size_t pos, qreal y) const
+{
+    const qreal x = xOf(line, pos);
+    QRectF cursor;
+    if (m_cursorStyle == CursorStyle::Bar) {
+        cursor = QRectF(x, y, 2, m_lineHeight);
+        painter.fillRect(cursor, palette().text());
+    } else {
+        const size_t offset = pos - line.start;
+        size_t length = 0;
+        if (pos < line.end) {
+            length = 1;
+            while (offset + length < line.bytes.size() &&
+                   (static_cast<unsigned char>(line.bytes[offset + length]) & 0xC0) == 0x80)
+                length++;
+        }
+        const std::string under = length ? line.bytes.substr(offset, length) : " ";
+        cursor = QRectF(x, y, widthOf(under), m_lineHeight);
+        QColor color = palette().text().color();
+        color.setAlpha(128);
+        painter.fillRect(cursor, color);
+    }
+    return cursor.toAlignedRect();
+}
+
+void
+TextView::paintFold(QPainter &painter, const Line &line, qreal x, qreal y) const
+{
+    painter.fillRect(QRectF(0, y, width(), m_lineHeight), palette().alternateBase());
+    QColor color = palette().text().color();
+    color.setAlpha(128);
+    painter.setPen(color);
+    const QString text = QString("  +%1 lines").arg(line.folded);
+    painter.drawText(QRectF(x, y, width() - x, m_lineHeight), Qt::AlignVCenter, text);
+}
+
+void
+TextView::paintCursors(QPainter &painter, const Line &line, qreal y) const
+{
+    /* only the cursors on the painted lines are looked at, however many there are */
+    auto it = std::lower_bound(m_cursors->begin(), m_cursors->end(), line.start);
+    for (; it != m_cursors->end() && *it <= line.end; ++it)
+        paintCursor(painter, line, *it, y);
+}
+
+} // namespace pico
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "editor/Folds.hpp"
+#include "editor/GlyphCache.hpp"
+#include "editor/Highlighter.hpp"
+#include "editor/PieceTable.hpp"
+#include "editor/Searcher.hpp"
+#include <QWidget>
+
+#include <QPainter>
+#include <QTimer>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace pico {
+
+/**
+ * Viewport of a TextEdit, lays out and paints only the visible lines of the document plus a small
+ * margin, so the cost of a repaint is independent of the document size
+ *
+ * Each row shows a line, a closed fold taking up the single row of its first line, so the lines
+ * it hides are never fetched, laid out or painted.
+ *
+ * With a fixed pitch font ASCII lines are measured by counting columns instead of shaping them,
+ * and shaped lines are kept in a GlyphCache so scrolling back over them only draws glyphs.
+ */
+class TextView : public QWidget
+{
+    Q_OBJECT
+
+public: /* types */
+    enum class CursorStyle {
+        Block,
+        Bar,
+    };
+
+public:
+    explicit TextView(const PieceTable &document, QWidget *parent = nullptr);
+
+    size_t
+    topRow(void) const;
+
+    /* scroll so row is the first visible one, rows still on screen are blitted */
+    void
+    setTopRow(size_t row);
+
+    /* repaints the rows of the old and new cursor only */
+    void
+    setCursorPosition(size_t pos);
+
+    void
+    setCursorStyle(CursorStyle style);
+
+    /* highlight the lines as they are painted, nullptr for plain text */
+    void
+    setHighlighter(Highlighter *highlighter);
+
+    /* matches to mark on the visible lines, sorted by offset, nullptr for none */
+    void
+    setMatches(const Searcher::matches_t *matches);
+
+    /* extra cursors to draw besides the primary one, sorted by offset, nullptr for none */
+    void
+    setCursors(const std::vector<size_t> *cursors);
+
+    /* folds mapping rows to lines, nullptr for none, lay out again once they change */
+    void
+    setFolds(const Folds *folds);
+
+    /* lay out the visible rows again, after the folds changed */
+    void
+    relayout(void);
+
+    /* short message drawn over the bottom right corner, such as a match count */
+    void
+    setStatus(const QString &status);
+
+    /* lines that fit in the view, counting a partially visible last one */
+    int
+    visibleLineCount(void) const;
+
+    /* the document changed at or after pos, lines ending before it are kept */
+    void
+    invalidate(size_t pos = 0);
+
+    const GlyphCache &
+    glyphCache(void) const;
+
+signals:
+    /* painting indexed more of a lazily indexed document, its line count may have changed */
+    void
+    documentIndexed(void);
+
+protected:
+    void
+    paintEvent(QPaintEvent *event) override;
+
+    void
+    changeEvent(QEvent *event) override;
+
+private: /* types */
+    struct Line {
+        /* line of the document shown */
+        size_t index;
+        /* lines hidden after it by a closed fold */
+        size_t folded;
+        size_t start;
+        /* offset of the ending newline, or the document size */
+        size_t end;
+        std::string bytes;
+        QString text;
+        bool ascii;
+    };
+
+private:
+    void
+    updateFontMetrics(void);
+
+    /* make sure the visible lines and the margin around them are laid out */
+    void
+    layout(void);
+
+    /* line shown on row, or nullptr if it is not laid out */
+    const Line *
+    line(size_t row) const;
+
+    /* cached line containing pos, or nullptr if it is not laid out */
+    const Line *
+    lineAt(size_t pos, size_t *row = nullptr) const;
+
+    /* x of the byte at pos within line */
+    qreal
+    xOf(const Line &line, size_t pos) const;
+
+    qreal
+    widthOf(const std::string &bytes) const;
+
+    QRect
+    rowRect(size_t row) const;
+
+    QRect
+    statusRect(void) const;
+
+    void
+    paintMatches(QPainter &painter, const Line &line, qreal y) const;
+
+    /* draw a cursor at pos on line, returns the area it covers */
+    QRect
+    paintCursor(QPainter &painter, const Line &line, size_t pos, qreal y) const;
+
+    void
+    paintCursors(QPainter &painter, const Line &line, qreal y) const;
+
+    /* mark line as the first of a closed fold, after x */
+    void
+    paintFold(QPainter &painter, const Line &line, qreal x, qreal y) const;
+
+private:
+    /* lines laid out above and below the visible ones so short scrolls need no document access */
+    static constexpr size_t margin = 16;
+    static constexpr int tabWidth = 4;
+    /* lines a highlighter lexes between two events when the view jumped past the lexed ones */
+    static constexpr size_t lexSlice = 20000;
+
+    const PieceTable &m_document;
+    std::deque<Line> m_lines;
+    /* row of the first line in m_lines */
+    size_t m_firstRow;
+    size_t m_topRow;
+    size_t m_cursor;
+    CursorStyle m_cursorStyle;
+    QRect m_cursorRect;
+    GlyphCache m_glyphs;
+    Highlighter *m_highlighter;
+    QTimer m_lexTimer;
+    const Searcher::matches_t *m_matches;
+    const std::vector<size_t> *m_cursors;
+    const Folds *m_folds;
+    QString m_status;
+    qreal m_lineHeight;
+    /* advance of every ASCII character in a fixed pitch font, 0 otherwise */
+    qreal m_advance;
+};
+
+} // namespace pico
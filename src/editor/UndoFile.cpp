@@ -0,0 +1,288 @@
+#include "UndoFile.hpp"
+#include "editor/Fingerprint.hpp"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+namespace pico {
+
+UndoFile::UndoFile(const QString &path, PieceTable &document, UndoTree &undo, QObject *parent)
+    : QObject(parent),
+      m_path(path),
+      m_location(location(path)),
+      m_document(document),
+      m_undo(undo),
+      m_opened(stat(path)),
+      m_idle(),
+      m_attached(false),
+      m_loaded(false),
+      m_base(0),
+      m_root(0),
+      m_rootHash({}),
+      m_written(1),
+      m_saving(false),
+      m_savingStep(0),
+      m_checkpoints()
+{
+    m_idle.setSingleShot(true);
+    m_idle.setInterval(idleInterval);
+    connect(&m_idle, &QTimer::timeout, this, &UndoFile::flush);
+}
+
+UndoFile::~UndoFile()
+{
+    flush();
+}
+
+QString
+UndoFile::location(const QString &path)
+{
+    const QFileInfo info(path);
+    const QString canonical = info.canonicalFilePath();
+    const QByteArray name = (canonical.isEmpty() ? info.absoluteFilePath() : canonical).toUtf8();
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) +
+           "/pico/undo/" + QCryptographicHash::hash(name, QCryptographicHash::Sha1).toHex();
+}
+
+UndoFile::Key
+UndoFile::stat(const QString &path)
+{
+    Key key;
+    const QFileInfo info(path);
+    key.mtime = info.lastModified().toMSecsSinceEpoch();
+    key.size = info.size();
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) == 0)
+        key.inode = st.st_ino;
+#endif
+    return key;
+}
+
+bool
+UndoFile::load(void)
+{
+    if (m_loaded)
+        return true;
+    m_loaded = true;
+
+    /* steps of this session already written keep their place in the history */
+    flush();
+    if (!attach() || m_base == 0)
+        return false;
+
+    /* the file on disk may have been rewritten with the same size within the same millisecond */
+    const std::string_view original = m_document.original();
+    Fingerprint fingerprint(original.size());
+    fingerprint.addData(original);
+    const QByteArray hash = fingerprint.result();
+    /* only the steps from before this session are grafted, the ones after it are in the tree */
+    std::vector<UndoTree::SavedStep> steps;
+    const bool ok = hash == m_rootHash && read(&steps, nullptr) && steps.size() >= m_base;
+    if (ok)
+        steps.resize(m_base);
+    if (!ok || !m_undo.graft(steps, m_root)) {
+        qWarning() << "discarding the undo history of" << m_path;
+        create();
+        m_written = 1;
+        flush();
+        return false;
+    }
+
+    for (Checkpoint &checkpoint : m_checkpoints)
+        checkpoint.step = fileStep(checkpoint.step);
+    m_savingStep = fileStep(m_savingStep);
+    m_written = fileStep(m_written);
+    /* the tree now numbers its steps like the history */
+    m_base = 0;
+    m_root = 0;
+    return true;
+}
+
+bool
+UndoFile::isLoaded(void) const
+{
+    return m_loaded;
+}
+
+void
+UndoFile::touch(void)
+{
+    m_idle.start();
+}
+
+void
+UndoFile::beginCheckpoint(void)
+{
+    m_saving = true;
+    m_savingStep = m_undo.current();
+}
+
+void
+UndoFile::endCheckpoint(bool ok, const QByteArray &hash)
+{
+    if (!m_saving)
+        return;
+    m_saving = false;
+    if (!ok)
+        return;
+
+    Key key = stat(m_path);
+    key.hash = hash;
+    m_checkpoints.push_back({ key, m_savingStep });
+    flush();
+}
+
+void
+UndoFile::flush(void)
+{
+    m_idle.stop();
+    const uint32_t closed = m_undo.closedSteps();
+    if (m_written >= closed && m_checkpoints.empty())
+        return;
+    if (!attach())
+        return;
+
+    QFile file(m_location);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "could not write undo history" << m_location << file.errorString();
+        return;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    for (; m_written < closed; m_written++) {
+        QByteArray record;
+        QDataStream step(&record, QIODevice::WriteOnly);
+        step.setVersion(QDataStream::Qt_6_0);
+        step << static_cast<quint32>(fileStep(m_undo.parent(m_written)));
+        m_undo.serializeStep(m_written, step);
+        out << static_cast<quint8>('S') << record;
+    }
+
+    /* a checkpoint can only refer to steps already in the history */
+    for (auto it = m_checkpoints.begin(); it != m_checkpoints.end();) {
+        if (it->step >= m_written) {
+            ++it;
+            continue;
+        }
+        QByteArray record;
+        QDataStream checkpoint(&record, QIODevice::WriteOnly);
+        checkpoint.setVersion(QDataStream::Qt_6_0);
+        checkpoint << it->key.inode << it->key.mtime << it->key.size << it->key.hash
+                   << static_cast<quint32>(fileStep(it->step));
+        out << static_cast<quint8>('W') << record;
+        it = m_checkpoints.erase(it);
+    }
+}
+
+bool
+UndoFile::attach(void)
+{
+    if (m_attached)
+        return true;
+
+    std::vector<UndoTree::SavedStep> steps;
+    std::vector<Checkpoint> checkpoints;
+    if (read(&steps, &checkpoints)) {
+        /* the hash is checked when loading, hashing the document is left until undo needs it */
+        for (auto it = checkpoints.rbegin(); it != checkpoints.rend(); ++it) {
+            if (it->key.inode == m_opened.inode && it->key.mtime == m_opened.mtime &&
+                it->key.size == m_opened.size) {
+                m_base = static_cast<uint32_t>(steps.size());
+                m_root = it->step;
+                m_rootHash = it->key.hash;
+                m_attached = true;
+                return true;
+            }
+        }
+    }
+    /* no history of the file as it is on disk */
+    return create();
+}
+
+bool
+UndoFile::create(void)
+{
+    m_base = 0;
+    m_root = 0;
+    m_rootHash.clear();
+
+    QDir().mkpath(QFileInfo(m_location).path());
+    QFile file(m_location);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "could not create undo history" << m_location << file.errorString();
+        return false;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << magic << version;
+    m_attached = true;
+    return true;
+}
+
+bool
+UndoFile::read(std::vector<UndoTree::SavedStep> *steps, std::vector<Checkpoint> *checkpoints)
+{
+    QFile file(m_location);
+    if (!file.exists() || !file.open(QIODevice::ReadWrite))
+        return false;
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 fileMagic = 0;
+    quint32 fileVersion = 0;
+    in >> fileMagic >> fileVersion;
+    if (in.status() != QDataStream::Ok || fileMagic != magic || fileVersion != version)
+        return false;
+
+    qint64 valid = file.pos();
+    while (!in.atEnd()) {
+        quint8 type = 0;
+        QByteArray record;
+        in >> type >> record;
+        if (in.status() != QDataStream::Ok)
+            break;
+
+        QDataStream fields(record);
+        fields.setVersion(QDataStream::Qt_6_0);
+        if (type == 'S') {
+            quint32 parent = 0;
+            fields >> parent;
+            if (steps)
+                steps->push_back({ parent, record.mid(sizeof(quint32)) });
+        } else if (type == 'W') {
+            Checkpoint checkpoint;
+            quint32 step = 0;
+            fields >> checkpoint.key.inode >> checkpoint.key.mtime >> checkpoint.key.size >>
+                checkpoint.key.hash >> step;
+            checkpoint.step = step;
+            if (checkpoints && fields.status() == QDataStream::Ok)
+                checkpoints->push_back(checkpoint);
+        }
+        valid = file.pos();
+    }
+
+    /* a record cut short by a crash would garble the ones appended after it */
+    if (valid < file.size())
+        file.resize(valid);
+    return true;
+}
+
+uint32_t
+UndoFile::fileStep(uint32_t step) const
+{
+    return step == 0 ? m_root : m_base + step;
+}
+
+} // namespace pico
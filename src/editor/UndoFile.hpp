@@ -0,0 +1,124 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include <vector>
+
+#include "editor/PieceTable.hpp"
+#include "editor/UndoTree.hpp"
+
+namespace pico {
+
+/**
+ * Undo history of a file kept in the XDG cache directory, so it survives closing the buffer
+ *
+ * The history is a log of steps and of the states the file was saved in, each identified by the
+ * inode, modification time and hash of what was written. Steps are appended once the editor has
+ * been idle for a while. Reading the history back is left until it is first needed to undo, it
+ * then becomes the part of the tree above the state the file was opened in, provided that state
+ * is one the log has seen saved.
+ */
+class UndoFile : public QObject
+{
+    Q_OBJECT
+
+public: /* types */
+    /* identifies the contents of a file on disk, the hash is a Fingerprint of the text saved */
+    struct Key {
+        quint64 inode = 0;
+        qint64 mtime = 0;
+        quint64 size = 0;
+        QByteArray hash;
+    };
+
+public:
+    UndoFile(const QString &path, PieceTable &document, UndoTree &undo, QObject *parent = nullptr);
+
+    /* appends the steps not written yet */
+    ~UndoFile();
+
+    /* the history file of path */
+    static QString
+    location(const QString &path);
+
+    /* key of the file at path, without the hash */
+    static Key
+    stat(const QString &path);
+
+    /* read the history back into the tree, once, false if there is none for the opened file */
+    bool
+    load(void);
+
+    bool
+    isLoaded(void) const;
+
+    /* a step was recorded, steps are appended once the editor has been idle for a while */
+    void
+    touch(void);
+
+    /* the current step is being saved to the file */
+    void
+    beginCheckpoint(void);
+
+    /* the save begun last is done, hash being that of the text written */
+    void
+    endCheckpoint(bool ok, const QByteArray &hash);
+
+    /* append the final steps and the checkpoints of finished saves */
+    void
+    flush(void);
+
+private: /* types */
+    struct Checkpoint {
+        Key key;
+        uint32_t step;
+    };
+
+private:
+    /* find where the opened file is in the history, or start a new one, done before writing */
+    bool
+    attach(void);
+
+    /* truncate the history and start over with the opened file as its root */
+    bool
+    create(void);
+
+    /* the records of the history, a record cut short at the end is dropped */
+    bool
+    read(std::vector<UndoTree::SavedStep> *steps, std::vector<Checkpoint> *checkpoints);
+
+    /* step of the history for step of the tree */
+    uint32_t
+    fileStep(uint32_t step) const;
+
+private:
+    static constexpr quint32 magic = 0x7069756e; /* "piun" */
+    static constexpr quint32 version = 1;
+    static constexpr int idleInterval = 2000;
+
+    QString m_path;
+    QString m_location;
+    PieceTable &m_document;
+    UndoTree &m_undo;
+    /* key of the file as it was opened, the root of the tree */
+    Key m_opened;
+    QTimer m_idle;
+    bool m_attached;
+    bool m_loaded;
+    /* until loaded, history steps before the ones of this session and the step opened at */
+    uint32_t m_base;
+    uint32_t m_root;
+    /* hash the file was saved with at m_root, checked against the document when loading */
+    QByteArray m_rootHash;
+    /* next step of the tree to write, the root is never written */
+    uint32_t m_written;
+    bool m_saving;
+    uint32_t m_savingStep;
+    /* checkpoints of finished saves, in steps of the tree */
+    std::vector<Checkpoint> m_checkpoints;
+};
+
+} // namespace pico
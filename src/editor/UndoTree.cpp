@@ -0,0 +1,421 @@
+#include "UndoTree.hpp"
+
+#include <algorithm>
+#include <string_view>
+
+namespace pico {
+
+static bool
+contiguous(const Piece &a, const Piece &b)
+{
+    return a.source == b.source && a.start + a.length == b.start;
+}
+
+UndoTree::UndoTree(PieceTable &document)
+    : m_document(document),
+      m_steps(),
+      m_splices(),
+      m_pieces(),
+      m_current(0),
+      m_groupDepth(0),
+      m_groupStep(0)
+{
+    clear();
+}
+
+void
+UndoTree::recordInsert(size_t pos, size_t length)
+{
+    if (length == 0)
+        return;
+    const std::vector<Piece> pieces = m_document.pieces(pos, length);
+
+    /* typing extends the text inserted right before it */
+    Splice *last = lastSplice();
+    if (last && last->insertedFirst + last->inserted == m_pieces.size() &&
+        pos == last->pos + bytes(last->insertedFirst, last->inserted)) {
+        appendPieces(last->inserted, pieces);
+        return;
+    }
+
+    Splice &splice = newSplice(pos);
+    appendPieces(splice.inserted, pieces);
+}
+
+void
+UndoTree::recordRemove(size_t pos, size_t length)
+{
+    if (pos >= m_document.size() || length == 0)
+        return;
+    length = std::min(length, m_document.size() - pos);
+    const std::vector<Piece> pieces = m_document.pieces(pos, length);
+
+    Splice *last = lastSplice();
+    if (last && last->insertedFirst + last->inserted == m_pieces.size()) {
+        const size_t inserted = bytes(last->insertedFirst, last->inserted);
+        /* backspacing over text typed in this splice takes it back out */
+        if (inserted > 0 && pos >= last->pos && pos + length == last->pos + inserted) {
+            trimPieces(last->inserted, length);
+            return;
+        }
+        /* deleting forward from the same offset, or backward from where the last delete began */
+        if (inserted == 0 && (pos == last->pos || pos + length == last->pos)) {
+            if (pos == last->pos) {
+                appendPieces(last->removed, pieces);
+            } else {
+                prependPieces(last->removed, last->removedFirst, pieces);
+                last->pos = pos;
+            }
+            last->insertedFirst = static_cast<uint32_t>(m_pieces.size());
+            return;
+        }
+    }
+
+    Splice &splice = newSplice(pos);
+    appendPieces(splice.removed, pieces);
+    splice.insertedFirst = static_cast<uint32_t>(m_pieces.size());
+}
+
+void
+UndoTree::beginGroup(void)
+{
+    if (m_groupDepth++ == 0)
+        m_groupStep = 0;
+}
+
+void
+UndoTree::endGroup(void)
+{
+    if (m_groupDepth > 0 && --m_groupDepth == 0)
+        m_groupStep = 0;
+}
+
+size_t
+UndoTree::undo(const splice_t &splice)
+{
+    if (m_current == 0)
+        return npos;
+
+    /* an edit after an undo starts a new step even within a group */
+    m_groupStep = 0;
+    const uint32_t step = m_current;
+    const size_t pos = apply(step, false, splice);
+    m_current = m_steps[step].parent;
+    m_steps[m_current].redo = step;
+    return pos;
+}
+
+size_t
+UndoTree::redo(const splice_t &splice)
+{
+    const uint32_t step = m_steps[m_current].redo;
+    if (step == 0)
+        return npos;
+
+    m_groupStep = 0;
+    const size_t pos = apply(step, true, splice);
+    m_current = step;
+    return pos;
+}
+
+size_t
+UndoTree::earlier(const splice_t &splice)
+{
+    if (m_current == 0)
+        return npos;
+    return moveTo(m_current - 1, splice);
+}
+
+size_t
+UndoTree::later(const splice_t &splice)
+{
+    if (m_current + 1 >= m_steps.size())
+        return npos;
+    return moveTo(m_current + 1, splice);
+}
+
+void
+UndoTree::clear(void)
+{
+    m_steps.assign(1, Step{ 0, 0, 0, 0 });
+    m_splices.clear();
+    m_pieces.clear();
+    m_current = 0;
+    m_groupStep = 0;
+}
+
+size_t
+UndoTree::steps(void) const
+{
+    return m_steps.size() - 1;
+}
+
+uint32_t
+UndoTree::current(void) const
+{
+    return m_current;
+}
+
+uint32_t
+UndoTree::parent(uint32_t step) const
+{
+    return m_steps[step].parent;
+}
+
+uint32_t
+UndoTree::closedSteps(void) const
+{
+    return m_groupStep != 0 ? m_groupStep : static_cast<uint32_t>(m_steps.size());
+}
+
+void
+UndoTree::serializeStep(uint32_t step, QDataStream &out) const
+{
+    auto writeText = [&](uint32_t first, uint32_t count) {
+        out << static_cast<quint64>(bytes(first, count));
+        for (uint32_t i = first; i < first + count; i++) {
+            const std::string_view text = m_document.view(m_pieces[i]);
+            out.writeRawData(text.data(), static_cast<int>(text.size()));
+        }
+    };
+
+    const Step &s = m_steps[step];
+    out << static_cast<quint32>(s.splices);
+    for (uint32_t i = s.firstSplice; i < s.firstSplice + s.splices; i++) {
+        const Splice &splice = m_splices[i];
+        out << static_cast<quint64>(splice.pos);
+        writeText(splice.removedFirst, splice.removed);
+        writeText(splice.insertedFirst, splice.inserted);
+    }
+}
+
+bool
+UndoTree::graft(const std::vector<SavedStep> &steps, uint32_t at)
+{
+    if (at > steps.size())
+        return false;
+
+    std::vector<Step> grafted(1, Step{ 0, 0, 0, 0 });
+    std::vector<Splice> splices;
+    std::vector<Piece> pieces;
+
+    /* the text of each splice is stored as one piece of the add buffer */
+    for (const SavedStep &saved : steps) {
+        const QByteArray &data = saved.splices;
+        QDataStream in(data);
+        auto readText = [&](uint32_t &count) {
+            quint64 length = 0;
+            in >> length;
+            const qint64 offset = in.device()->pos();
+            if (in.status() != QDataStream::Ok || length > quint64(data.size() - offset))
+                return false;
+            if (length > 0) {
+                pieces.push_back(m_document.store(
+                    std::string_view(data.constData() + offset, static_cast<size_t>(length))));
+                count = 1;
+            }
+            return in.skipRawData(static_cast<int>(length)) == static_cast<int>(length);
+        };
+
+        const uint32_t parent = saved.parent;
+        quint32 count = 0;
+        in >> count;
+        const auto index = static_cast<uint32_t>(grafted.size());
+        if (in.status() != QDataStream::Ok || parent >= index)
+            return false;
+
+        grafted.push_back({ parent, 0, static_cast<uint32_t>(splices.size()), count });
+        grafted[parent].redo = index;
+        for (quint32 i = 0; i < count; i++) {
+            quint64 pos = 0;
+            in >> pos;
+            Splice splice{ static_cast<size_t>(pos), 0, 0, 0, 0 };
+            splice.removedFirst = static_cast<uint32_t>(pieces.size());
+            if (!readText(splice.removed))
+                return false;
+            splice.insertedFirst = static_cast<uint32_t>(pieces.size());
+            if (!readText(splice.inserted))
+                return false;
+            splices.push_back(splice);
+        }
+    }
+
+    /* the steps recorded since opening follow, their root is step at */
+    const auto base = static_cast<uint32_t>(grafted.size() - 1);
+    auto map = [&](uint32_t step) {
+        return step == 0 ? at : base + step;
+    };
+    const auto spliceBase = static_cast<uint32_t>(splices.size());
+    const auto pieceBase = static_cast<uint32_t>(pieces.size());
+    if (m_steps[0].redo != 0)
+        grafted[at].redo = map(m_steps[0].redo);
+    for (size_t i = 1; i < m_steps.size(); i++) {
+        Step step = m_steps[i];
+        step.parent = map(step.parent);
+        step.redo = step.redo != 0 ? map(step.redo) : 0;
+        step.firstSplice += spliceBase;
+        grafted.push_back(step);
+    }
+    for (Splice splice : m_splices) {
+        splice.removedFirst += pieceBase;
+        splice.insertedFirst += pieceBase;
+        splices.push_back(splice);
+    }
+    pieces.insert(pieces.end(), m_pieces.begin(), m_pieces.end());
+
+    m_steps = std::move(grafted);
+    m_splices = std::move(splices);
+    m_pieces = std::move(pieces);
+    m_current = map(m_current);
+    if (m_groupStep != 0)
+        m_groupStep = map(m_groupStep);
+    return true;
+}
+
+size_t
+UndoTree::memory(void) const
+{
+    return sizeof(*this) + m_steps.capacity() * sizeof(Step) +
+           m_splices.capacity() * sizeof(Splice) + m_pieces.capacity() * sizeof(Piece);
+}
+
+UndoTree::Step &
+UndoTree::stepForEdit(void)
+{
+    if (m_groupDepth > 0 && m_groupStep != 0 && m_groupStep == m_current)
+        return m_steps[m_current];
+
+    const auto step = static_cast<uint32_t>(m_steps.size());
+    m_steps.push_back({ m_current, 0, static_cast<uint32_t>(m_splices.size()), 0 });
+    m_steps[m_current].redo = step;
+    m_current = step;
+    if (m_groupDepth > 0)
+        m_groupStep = step;
+    return m_steps.back();
+}
+
+UndoTree::Splice *
+UndoTree::lastSplice(void)
+{
+    /* the open step is always the last one recorded, its splices end the list */
+    if (m_groupDepth == 0 || m_groupStep == 0 || m_groupStep != m_current)
+        return nullptr;
+    if (m_steps[m_current].splices == 0)
+        return nullptr;
+    return &m_splices.back();
+}
+
+UndoTree::Splice &
+UndoTree::newSplice(size_t pos)
+{
+    stepForEdit().splices++;
+    const auto first = static_cast<uint32_t>(m_pieces.size());
+    m_splices.push_back({ pos, first, 0, first, 0 });
+    return m_splices.back();
+}
+
+void
+UndoTree::appendPieces(uint32_t &count, const std::vector<Piece> &pieces)
+{
+    for (const Piece &piece : pieces) {
+        if (count > 0 && contiguous(m_pieces.back(), piece)) {
+            m_pieces.back().length += piece.length;
+        } else {
+            m_pieces.push_back(piece);
+            count++;
+        }
+    }
+}
+
+void
+UndoTree::prependPieces(uint32_t &count, uint32_t first, const std::vector<Piece> &pieces)
+{
+    if (pieces.empty())
+        return;
+
+    auto end = pieces.end();
+    if (count > 0 && contiguous(pieces.back(), m_pieces[first])) {
+        m_pieces[first].start = pieces.back().start;
+        m_pieces[first].length += pieces.back().length;
+        --end;
+    }
+    m_pieces.insert(m_pieces.begin() + first, pieces.begin(), end);
+    count += static_cast<uint32_t>(end - pieces.begin());
+}
+
+void
+UndoTree::trimPieces(uint32_t &count, size_t length)
+{
+    while (length > 0 && count > 0) {
+        Piece &piece = m_pieces.back();
+        if (piece.length > length) {
+            piece.length -= length;
+            return;
+        }
+        length -= piece.length;
+        m_pieces.pop_back();
+        count--;
+    }
+}
+
+size_t
+UndoTree::bytes(uint32_t first, uint32_t count) const
+{
+    size_t bytes = 0;
+    for (uint32_t i = first; i < first + count; i++)
+        bytes += m_pieces[i].length;
+    return bytes;
+}
+
+size_t
+UndoTree::apply(uint32_t step, bool forward, const splice_t &splice)
+{
+    const Step &s = m_steps[step];
+    if (s.splices == 0)
+        return npos;
+
+    if (forward) {
+        for (uint32_t i = s.firstSplice; i < s.firstSplice + s.splices; i++) {
+            const Splice &sp = m_splices[i];
+            splice(sp.pos, bytes(sp.removedFirst, sp.removed), m_pieces.data() + sp.insertedFirst,
+                   sp.inserted);
+        }
+    } else {
+        for (uint32_t i = s.firstSplice + s.splices; i-- > s.firstSplice;) {
+            const Splice &sp = m_splices[i];
+            splice(sp.pos, bytes(sp.insertedFirst, sp.inserted), m_pieces.data() + sp.removedFirst,
+                   sp.removed);
+        }
+    }
+    return m_splices[s.firstSplice].pos;
+}
+
+size_t
+UndoTree::moveTo(uint32_t target, const splice_t &splice)
+{
+    /*
+     * a child is always recorded after its parent, so walking up the later of the two meets the
+     * common ancestor, undoing on the way up from the current step and redoing on the way down
+     */
+    size_t pos = npos;
+    std::vector<uint32_t> down;
+    uint32_t from = m_current;
+    while (from != target) {
+        if (from > target) {
+            pos = apply(from, false, splice);
+            from = m_steps[from].parent;
+        } else {
+            down.push_back(target);
+            target = m_steps[target].parent;
+        }
+    }
+    for (auto it = down.rbegin(); it != down.rend(); ++it) {
+        pos = apply(*it, true, splice);
+        m_steps[m_steps[*it].parent].redo = *it;
+    }
+    m_current = down.empty() ? from : down.front();
+    m_groupStep = 0;
+    return pos;
+}
+
+} // namespace pico
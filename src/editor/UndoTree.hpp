@@ -0,0 +1,172 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDataStream>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "editor/PieceTable.hpp"
+
+namespace pico {
+
+/**
+ * Undo history of a PieceTable stored as splice records, each one an offset and the pieces it
+ * removed and inserted
+ *
+ * Pieces refer to the document's buffers rather than holding text, the add buffer is append-only
+ * so they stay valid for as long as the document does. A step costs a few dozen bytes, the text
+ * it inserted is already kept by the add buffer. Consecutive typing or deleting within a step is
+ * merged into a single splice.
+ *
+ * Steps form a tree, an edit after an undo starts a new branch and redo follows the branch that
+ * was visited last. earlier and later move through the steps in the order they were recorded,
+ * across branches.
+ */
+class UndoTree
+{
+public: /* types */
+    /* replace length bytes at pos with count pieces, applying a recorded splice to the document */
+    typedef std::function<void(size_t pos, size_t length, const Piece *pieces, size_t count)>
+        splice_t;
+
+    /* a step read back from disk, its splices as written by serializeStep */
+    struct SavedStep {
+        uint32_t parent;
+        QByteArray splices;
+    };
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+public:
+    explicit UndoTree(PieceTable &document);
+
+    /* length bytes were just inserted at pos */
+    void
+    recordInsert(size_t pos, size_t length);
+
+    /* length bytes at pos are about to be removed */
+    void
+    recordRemove(size_t pos, size_t length);
+
+    /* edits until the matching endGroup are undone as one step, groups nest */
+    void
+    beginGroup(void);
+
+    void
+    endGroup(void);
+
+    /* undo the current step through splice, returns where it changed the document or npos */
+    size_t
+    undo(const splice_t &splice);
+
+    size_t
+    redo(const splice_t &splice);
+
+    /* move to the state before or after the current one in recording order */
+    size_t
+    earlier(const splice_t &splice);
+
+    size_t
+    later(const splice_t &splice);
+
+    void
+    clear(void);
+
+    /* steps recorded, including the ones on abandoned branches */
+    size_t
+    steps(void) const;
+
+    /* current step, 0 being the document as it was opened */
+    uint32_t
+    current(void) const;
+
+    /* steps before this one are final, the step of an open group may still grow */
+    uint32_t
+    closedSteps(void) const;
+
+    uint32_t
+    parent(uint32_t step) const;
+
+    /* write the splices of step with the text of their pieces, for an UndoFile */
+    void
+    serializeStep(uint32_t step, QDataStream &out) const;
+
+    /*
+     * put steps read back from disk under the root, steps[i] becoming step i + 1, the state the
+     * document was opened in becomes step at and the steps recorded since are renumbered to
+     * follow, false if the steps are malformed
+     */
+    bool
+    graft(const std::vector<SavedStep> &steps, uint32_t at);
+
+    /* bytes taken by the history, the inserted text held by the add buffer is not counted */
+    size_t
+    memory(void) const;
+
+private: /* types */
+    struct Splice {
+        size_t pos;
+        uint32_t removedFirst;
+        uint32_t removed;
+        uint32_t insertedFirst;
+        uint32_t inserted;
+    };
+
+    struct Step {
+        uint32_t parent;
+        /* child redo moves to, 0 if none as the root is nobody's child */
+        uint32_t redo;
+        uint32_t firstSplice;
+        uint32_t splices;
+    };
+
+private:
+    /* step taking the next splice, a new child of the current step unless a group is open */
+    Step &
+    stepForEdit(void);
+
+    /* last splice of the step of the open group, null if there is none to merge into */
+    Splice *
+    lastSplice(void);
+
+    Splice &
+    newSplice(size_t pos);
+
+    /* append pieces to the range of count pieces ending the arena */
+    void
+    appendPieces(uint32_t &count, const std::vector<Piece> &pieces);
+
+    /* insert pieces in front of the range of count pieces at first */
+    void
+    prependPieces(uint32_t &count, uint32_t first, const std::vector<Piece> &pieces);
+
+    /* drop length bytes from the end of the range of count pieces ending the arena */
+    void
+    trimPieces(uint32_t &count, size_t length);
+
+    size_t
+    bytes(uint32_t first, uint32_t count) const;
+
+    /* undo or redo step, returns the offset of its first splice */
+    size_t
+    apply(uint32_t step, bool forward, const splice_t &splice);
+
+    /* undo and redo steps until target is the current step */
+    size_t
+    moveTo(uint32_t target, const splice_t &splice);
+
+private:
+    PieceTable &m_document;
+    std::vector<Step> m_steps;
+    std::vector<Splice> m_splices;
+    /* pieces of all splices, each splice refers to two ranges of it */
+    std::vector<Piece> m_pieces;
+    uint32_t m_current;
+    unsigned m_groupDepth;
+    /* step the open group records into, 0 until its first edit */
+    uint32_t m_groupStep;
+};
+
+} // namespace pico
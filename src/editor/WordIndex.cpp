@@ -0,0 +1,114 @@
+#include "WordIndex.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+#include <utility>
+
+namespace pico {
+
+WordIndex::WordIndex(void)
+    : m_words(),
+      m_ranked()
+{}
+
+bool
+WordIndex::isWordByte(char c)
+{
+    const auto byte = static_cast<unsigned char>(c);
+    return byte >= 0x80 || std::isalnum(byte) || c == '_';
+}
+
+void
+WordIndex::count(std::string_view text, int delta)
+{
+    /* a loaded file repeats its words, the sorted index is only looked up once for each */
+    std::unordered_map<std::string_view, int> words;
+    size_t start = 0;
+    while (start < text.size()) {
+        while (start < text.size() && !isWordByte(text[start]))
+            start++;
+        size_t end = start;
+        while (end < text.size() && isWordByte(text[end]))
+            end++;
+        /* numbers are not identifiers */
+        if (end > start && !std::isdigit(static_cast<unsigned char>(text[start])))
+            words[text.substr(start, end - start)] += delta;
+        start = end;
+    }
+    for (const auto &[word, times] : words)
+        countWord(word, times);
+}
+
+std::vector<std::string>
+WordIndex::complete(std::string_view prefix, size_t limit) const
+{
+    std::vector<std::pair<size_t, std::string_view>> matches;
+    for (auto it = m_words.lower_bound(prefix); it != m_words.end(); ++it) {
+        if (it->first.compare(0, prefix.size(), prefix) != 0)
+            break;
+        if (matches.size() >= maxScanned)
+            return mostFrequent(prefix, limit);
+        if (it->first.size() > prefix.size())
+            matches.push_back({ it->second, it->first });
+    }
+
+    limit = std::min(limit, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + limit, matches.end(), MoreFrequent());
+
+    std::vector<std::string> words;
+    words.reserve(limit);
+    for (size_t i = 0; i < limit; i++)
+        words.emplace_back(matches[i].second);
+    return words;
+}
+
+size_t
+WordIndex::size(void) const
+{
+    return m_words.size();
+}
+
+void
+WordIndex::countWord(std::string_view word, int delta)
+{
+    if (word.size() < minLength || word.size() > maxLength)
+        return;
+    if (delta > 0) {
+        auto it = m_words.lower_bound(word);
+        if (it == m_words.end() || it->first != word)
+            it = m_words.emplace_hint(it, std::string(word), 0);
+        else
+            m_ranked.erase({ it->second, it->first });
+        it->second += delta;
+        m_ranked.insert({ it->second, it->first });
+        return;
+    }
+
+    /* a word taken out more often than it was added was never indexed, it is ignored */
+    auto it = m_words.find(word);
+    if (it == m_words.end())
+        return;
+    m_ranked.erase({ it->second, it->first });
+    if (it->second <= static_cast<size_t>(-delta)) {
+        m_words.erase(it);
+        return;
+    }
+    it->second -= -delta;
+    m_ranked.insert({ it->second, it->first });
+}
+
+std::vector<std::string>
+WordIndex::mostFrequent(std::string_view prefix, size_t limit) const
+{
+    /* only called with thousands of words matching, so they come up often in any order */
+    std::vector<std::string> words;
+    for (auto it = m_ranked.begin(); it != m_ranked.end() && words.size() < limit; ++it) {
+        const std::string_view word = it->second;
+        if (word.size() > prefix.size() && word.compare(0, prefix.size(), prefix) == 0)
+            words.emplace_back(word);
+    }
+    return words;
+}
+
+} // namespace pico
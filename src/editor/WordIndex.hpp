@@ -0,0 +1,72 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pico {
+
+/**
+ * Identifiers of every open document with the number of times each occurs, for completion
+ *
+ * The index is never built by scanning a buffer again, editors take the words an edit touches out
+ * of it before the edit and put them back after, so keeping it current costs what the edit costs.
+ * Words are kept sorted, the words with a prefix are the range starting at its lower bound. They
+ * are also kept from the most frequent, which a short prefix matching many words walks instead.
+ */
+class WordIndex
+{
+public:
+    WordIndex(void);
+
+    /* as in vim, anything outside ASCII is part of a word */
+    static bool
+    isWordByte(char c);
+
+    /* longer runs are data rather than identifiers and are not counted */
+    static constexpr size_t maxLength = 64;
+
+    /* add the words of text, or take them out with a negative delta */
+    void
+    count(std::string_view text, int delta);
+
+    /* words starting with prefix but for prefix itself, the most frequent first */
+    std::vector<std::string>
+    complete(std::string_view prefix, size_t limit) const;
+
+    /* distinct words */
+    size_t
+    size(void) const;
+
+private:
+    void
+    countWord(std::string_view word, int delta);
+
+    std::vector<std::string>
+    mostFrequent(std::string_view prefix, size_t limit) const;
+
+private:
+    /* ties keep the sorted order, so the candidates do not shuffle between lookups */
+    struct MoreFrequent {
+        bool
+        operator()(const std::pair<size_t, std::string_view> &a,
+                   const std::pair<size_t, std::string_view> &b) const
+        {
+            return a.first > b.first || (a.first == b.first && a.second < b.second);
+        }
+    };
+
+    /* single characters are not worth completing */
+    static constexpr size_t minLength = 2;
+    /* more words with a prefix than this are not ranked, the frequent ones are walked instead */
+    static constexpr size_t maxScanned = 2048;
+
+    std::map<std::string, size_t, std::less<>> m_words;
+    /* count and word of each entry of m_words, whose keys the views point at */
+    std::set<std::pair<size_t, std::string_view>, MoreFrequent> m_ranked;
+};
+
+} // namespace pico
@@ -4,6 +4,7 @@
 
 #include "qlightterminal.h"
 
+#include <QApplication>
 #include <QByteArray>
 #include <QClipboard>
 #include <QFontMetricsF>
@@ -68,6 +69,35 @@ QLightTerminal::QLightTerminal(QWidget *parent)
 
     // connect close event of the tty
     connect(st, &SimpleTerminal::s_closed, this, &QLightTerminal::close);
+
+    // the terminal thread only signals the bell, beeping needs the GUI thread
+    connect(st, &SimpleTerminal::s_bell, this, []() { QApplication::beep(); });
+
+    // parse the tty off the GUI thread, the view only reads the published snapshots
+    st->moveToThread(&ioThread);
+    connect(&ioThread, &QThread::finished, st, &QObject::deleteLater);
+    ioThread.start();
+}
+
+QLightTerminal::~QLightTerminal()
+{
+    ioThread.quit();
+    ioThread.wait();
+}
+
+void
+QLightTerminal::post(std::function<void()> task)
+{
+    QMetaObject::invokeMethod(st, [this, task]() {
+        task();
+        st->scheduleUpdate();
+    });
+}
+
+void
+QLightTerminal::write(QByteArray data)
+{
+    post([this, data]() { st->ttywrite(data.constData(), data.size(), 1); });
 }
 
 void
@@ -86,14 +116,16 @@ QLightTerminal::close()
 }
 
 void
-QLightTerminal::updateTerminal(Term *term)
+QLightTerminal::updateTerminal()
 {
+    const TermSnapshot &snap = st->snapshots.acquire();
+
     cursorVisible = true;
     cursorTimer.start(750);
 
-    if (st->term.histi != scrollbar.maximum()) {
+    if (snap.histi != scrollbar.maximum()) {
         bool isMax = scrollbar.value() == scrollbar.value();
-        scrollbar.setMaximum(st->term.histi * win.scrollMultiplier);
+        scrollbar.setMaximum(snap.histi * win.scrollMultiplier);
 
         // stick to the bottom
         if (isMax) {
@@ -107,14 +139,17 @@ QLightTerminal::updateTerminal(Term *term)
 void
 QLightTerminal::scrollX(int n)
 {
-    int scroll = (st->term.scr - (scrollbar.maximum() - scrollbar.value()) / win.scrollMultiplier);
+    int target = (scrollbar.maximum() - scrollbar.value()) / win.scrollMultiplier;
 
-    if (scroll < 0) {
-        st->kscrollup(-scroll);
-    } else {
-        st->kscrolldown(scroll);
-    }
-    update();
+    post([this, target]() {
+        int scroll = st->term.scr - target;
+
+        if (scroll < 0) {
+            st->kscrollup(-scroll);
+        } else {
+            st->kscrolldown(scroll);
+        }
+    });
 }
 
 void
@@ -174,6 +209,7 @@ QLightTerminal::paintEvent(QPaintEvent *event)
         return;
     }
 
+    const TermSnapshot &snap = st->snapshots.acquire();
     QFont font;
     QString line;
     uint32_t fgColor = 0;
@@ -190,7 +226,7 @@ QLightTerminal::paintEvent(QPaintEvent *event)
     int drawHeight = (event->rect().height()) / win.lineheight; // height of the viewPort in lines
     int drawEnd = drawOffset + drawHeight;                      // last line index of the viewPort
 
-    int i = MIN(drawEnd, win.viewPortHeight);
+    int i = MIN(MIN(drawEnd, win.viewPortHeight), snap.row);
     int stop = MAX(i - drawHeight, 0);
     double yPos = i * win.lineheight + win.vPadding; // y position of the the lastViewPortLine
 
@@ -202,13 +238,10 @@ QLightTerminal::paintEvent(QPaintEvent *event)
         offset = win.hPadding;
         line = QString();
 
-        // same logic as TLine from st-utils
-        Glyph *tLine =
-            ((i) < st->term.scr
-                 ? st->term.hist[((i) + st->term.histi - st->term.scr + HISTSIZE + 1) % HISTSIZE]
-                 : st->term.line[(i)-st->term.scr]);
+        // rows of the snapshot are as TLINE from st-utils gives them
+        const Glyph *tLine = snap.glyphs.data() + i * snap.col;
 
-        for (int j = 0; j < st->term.col; j++) {
+        for (int j = 0; j < snap.col; j++) {
             Glyph g = tLine[j];
             if (g.mode == ATTR_WDUMMY)
                 continue;
@@ -225,10 +258,6 @@ QLightTerminal::paintEvent(QPaintEvent *event)
                 changed = true;
             }
 
-            if (st->selected(j, i)) {
-                g.mode ^= ATTR_REVERSE;
-            }
-
             if (mode != g.mode) {
                 mode = g.mode;
                 changed = true;
@@ -300,20 +329,20 @@ QLightTerminal::paintEvent(QPaintEvent *event)
         yPos -= win.lineheight;
     }
 
-    if (st->term.scr != 0) {
-        return; // do not draw, cursor is scrolled out of view
+    if (snap.scr != 0 || snap.row == 0) {
+        return; // do not draw, cursor is scrolled out of view or nothing is published yet
     }
 
     // draw cursor
     // drawn by reversing foreground color and background color
-    fgColor = st->term.c.attr.bg;
+    fgColor = snap.c.attr.bg;
     if (IS_TRUECOL(fgColor)) {
         painter.setPen(
             QColor(RED_FROM_TRUE(fgColor), GREEN_FROM_TRUE(fgColor), BLUE_FROM_TRUE(fgColor)));
     } else {
         painter.setPen(colors[fgColor]);
     }
-    bgColor = st->term.c.attr.fg;
+    bgColor = snap.c.attr.fg;
     if (IS_TRUECOL(bgColor)) {
         painter.setBackground(QBrush(
             QColor(RED_FROM_TRUE(bgColor), GREEN_FROM_TRUE(bgColor), BLUE_FROM_TRUE(bgColor))));
@@ -323,12 +352,13 @@ QLightTerminal::paintEvent(QPaintEvent *event)
 
     line = QString();
 
-    for (int i = 0; i < st->term.c.x; i++) {
-        line += QChar(st->term.line[st->term.c.y][i].u);
+    const Glyph *cursorLine = snap.glyphs.data() + snap.c.y * snap.col;
+    for (int i = 0; i < snap.c.x; i++) {
+        line += QChar(cursorLine[i].u);
     }
     int cursorOffset = line.size() * win.charWith;
 
-    double cursorPosVert = MIN(st->term.c.y + 1, win.viewPortHeight); // line of the cursor
+    double cursorPosVert = MIN(snap.c.y + 1, win.viewPortHeight); // line of the cursor
 
     auto cursorPos =
         QPointF(cursorOffset + win.hPadding, cursorPosVert * win.lineheight + win.vPadding);
@@ -337,7 +367,7 @@ QLightTerminal::paintEvent(QPaintEvent *event)
         return;
     }
 
-    QChar charAtCursor = QChar(st->term.line[st->term.c.y][st->term.c.x].u);
+    QChar charAtCursor = QChar(cursorLine[snap.c.x].u);
     painter.drawText(cursorPos, charAtCursor);
 
     /**
@@ -369,9 +399,9 @@ QLightTerminal::keyPressEvent(QKeyEvent *e)
 
     if (key == Qt::Key_Backspace) {
         if (mods.testFlag(Qt::KeyboardModifier::AltModifier)) {
-            st->ttywrite("\033\177", 2, 1);
+            write(QByteArray("\033\177", 2));
         } else {
-            st->ttywrite("\177", 1, 1);
+            write(QByteArray("\177", 1));
         }
         return;
     }
@@ -382,7 +412,7 @@ QLightTerminal::keyPressEvent(QKeyEvent *e)
         QClipboard *clipboard = QGuiApplication::clipboard();
         QString clippedText = clipboard->text();
         QByteArray data = clippedText.toLocal8Bit();
-        st->ttywrite(data.data(), data.size(), 1);
+        post([this, data]() { st->ttypaste(data.constData(), data.size()); });
         return;
     }
 
@@ -390,7 +420,17 @@ QLightTerminal::keyPressEvent(QKeyEvent *e)
     if (key == 67 && mods & Qt::KeyboardModifier::ShiftModifier &&
         mods & Qt::KeyboardModifier::ControlModifier) {
         QClipboard *clipboard = QGuiApplication::clipboard();
-        QString clippedText = QString(st->getsel());
+        QString clippedText;
+        // the selection is the terminal's, wait for its thread to copy it out
+        QMetaObject::invokeMethod(
+            st,
+            [this]() {
+                char *sel = st->getsel();
+                QString text = QString(sel);
+                free(sel);
+                return text;
+            },
+            Qt::BlockingQueuedConnection, &clippedText);
         clipboard->setText(clippedText);
         return;
     }
@@ -403,7 +443,7 @@ QLightTerminal::keyPressEvent(QKeyEvent *e)
         } else {
             text = e->text().toUtf8();
         }
-        st->ttywrite(text, text.size(), 1);
+        write(text);
     } else {
         // special keys
         // TODO: Add more short cuts
@@ -418,7 +458,7 @@ QLightTerminal::keyPressEvent(QKeyEvent *e)
             if (key == keys[i].key) {
                 for (int j = i; j < i + nextKey; j++) {
                     if (mods.testFlag(keys[j].mods)) {
-                        st->ttywrite(keys[j].cmd, keys[j].cmd_size, 1);
+                        write(QByteArray(keys[j].cmd, keys[j].cmd_size));
                         return;
                     }
                 }
@@ -436,8 +476,7 @@ QLightTerminal::mousePressEvent(QMouseEvent *event)
     lastMousePos = event->pos();
 
     // reset old selection
-    st->selclear();
-    update();
+    post([this]() { st->selclear(); });
 
     // select line if tripple click
     if (QDateTime::currentMSecsSinceEpoch() - lastClick < 500) {
@@ -446,7 +485,7 @@ QLightTerminal::mousePressEvent(QMouseEvent *event)
         int col = (pos.x() - win.hPadding) / win.charWith;
         int row = (pos.y() - win.vPadding) / win.lineheight;
 
-        st->selstart(col, row, SNAP_LINE);
+        post([this, col, row]() { st->selstart(col, row, SNAP_LINE); });
     }
 
     // draw cursor
@@ -469,10 +508,9 @@ QLightTerminal::mouseReleaseEvent(QMouseEvent *event)
         col = MIN(col, win.viewPortWidth - 1);
         row = MIN(row, win.viewPortHeight - 1);
 
-        st->selextend(col, row, SEL_REGULAR, 1);
+        post([this, col, row]() { st->selextend(col, row, SEL_REGULAR, 1); });
         selectionStarted = false;
         selectionTimer.stop();
-        update();
     }
 };
 
@@ -492,7 +530,7 @@ QLightTerminal::mouseMoveEvent(QMouseEvent *event)
                 return;
             }
 
-            st->selstart(col, row, 0);
+            post([this, col, row]() { st->selstart(col, row, 0); });
             selectionTimer.start(100);
             selectionStarted = true;
         }
@@ -539,8 +577,7 @@ QLightTerminal::updateSelection()
         col = MIN(col, win.viewPortWidth - 1);
         row = MIN(row, win.viewPortHeight - 1);
 
-        st->selextend(col, row, SEL_REGULAR, 0);
-        update();
+        post([this, col, row]() { st->selextend(col, row, SEL_REGULAR, 0); });
     }
 }
 
@@ -559,12 +596,12 @@ QLightTerminal::mouseDoubleClickEvent(QMouseEvent *event)
         return;
     }
 
-    st->selclear();
-    st->selstart(col, row, SNAP_WORD);
+    post([this, col, row]() {
+        st->selclear();
+        st->selstart(col, row, SNAP_WORD);
+    });
 
     lastClick = QDateTime::currentMSecsSinceEpoch();
-
-    update();
 }
 
 void
@@ -606,8 +643,12 @@ QLightTerminal::resize()
     win.viewPortWidth = cols;
     win.viewPortHeight = rows;
 
-    st->tresize(cols, win.viewPortHeight);
-    st->ttyresize(cols * 8.5, win.viewPortHeight * win.lineheight);
+    int tw = cols * 8.5;
+    int th = win.viewPortHeight * win.lineheight;
+    post([this, cols, rows, tw, th]() {
+        st->tresize(cols, rows);
+        st->ttyresize(tw, th);
+    });
 }
 
 void
@@ -11,10 +11,13 @@
 #include <QPointF>
 #include <QScrollBar>
 #include <QStringList>
+#include <QThread>
 #include <QTime>
 #include <QTimer>
 #include <QWidget>
 
+#include <functional>
+
 #include "st.h"
 
 typedef struct {
@@ -47,9 +50,11 @@ class QLightTerminal : public QWidget
 public:
     QLightTerminal(QWidget *parent = nullptr);
 
+    ~QLightTerminal();
+
 public slots:
     void
-    updateTerminal(Term *term);
+    updateTerminal();
 
     /*
      * Scrolls the terminal vertically to the given offset
@@ -111,7 +116,12 @@ protected:
     paintEvent(QPaintEvent *event) override;
 
 private:
+    /*
+     * The terminal reads the tty and parses it on ioThread, the view paints the snapshots it
+     * publishes and hands everything else to it with post()
+     */
     SimpleTerminal *st;
+    QThread ioThread;
     QScrollBar scrollbar;
     QHBoxLayout boxLayout;
     QTimer cursorTimer;
@@ -124,6 +134,13 @@ private:
     void
     setupScrollbar();
 
+    /* run task on the terminal's thread and publish the screen it leaves */
+    void
+    post(std::function<void()> task);
+
+    void
+    write(QByteArray data);
+
     void
     updateStyleSheet();
 
@@ -0,0 +1,123 @@
+#ifndef STPARSER_H
+#define STPARSER_H
+
+#include <stdint.h>
+
+/*
+ * Escape sequence parser after the DEC VT500 state diagram by Paul Williams.
+ * Every state has a transition for each of the 256 first code points, giving
+ * the action to perform and the state to enter. Runes past 0xFF are looked up
+ * as 0xFF. OSC, DCS, SOS, PM and APC strings share one state, their contents
+ * are collected whole as strhandle expects them.
+ */
+
+/* parser states, term.esc holds the current one */
+enum vt_state {
+    VT_GROUND,
+    VT_ESCAPE,
+    VT_ESCAPE_INTERMEDIATE,
+    VT_CSI_ENTRY,
+    VT_CSI_PARAM,
+    VT_CSI_INTERMEDIATE,
+    VT_CSI_IGNORE,
+    VT_STR,
+    VT_STATE_COUNT,
+    VT_STAY = 15, /* the transition keeps the state and skips its entry action */
+};
+
+enum vt_action {
+    VT_IGNORE,
+    VT_PRINT,
+    VT_EXECUTE,
+    VT_COLLECT,      /* intermediate or private marker */
+    VT_PARAM,
+    VT_ESC_DISPATCH,
+    VT_CSI_DISPATCH,
+    VT_STR_PUT,
+    VT_STR_END,      /* ESC ending a string, dispatched if ST follows */
+    VT_STR_DISPATCH,
+};
+
+#define VT_TRANSITION(action, state) ((uint8_t) ((action) | (state) << 4))
+#define VT_ACTION(t) ((t) & 0x0F)
+#define VT_STATE(t) ((t) >> 4)
+
+typedef struct {
+    uint8_t t[VT_STATE_COUNT][256];
+} VTTable;
+
+static constexpr void vtrange(VTTable &table, int state, int from, int to, int action, int next) {
+    for (int c = from; c <= to; c++)
+        table.t[state][c] = VT_TRANSITION(action, next);
+}
+
+static constexpr VTTable vtbuild() {
+    VTTable table = {};
+    int s = 0;
+
+    for (s = 0; s < VT_STATE_COUNT; s++) {
+        vtrange(table, s, 0x00, 0xFF, VT_IGNORE, VT_STAY);
+        /* C0 controls are executed in the middle of a sequence */
+        vtrange(table, s, 0x00, 0x17, VT_EXECUTE, VT_STAY);
+        vtrange(table, s, 0x19, 0x19, VT_EXECUTE, VT_STAY);
+        vtrange(table, s, 0x1C, 0x1F, VT_EXECUTE, VT_STAY);
+    }
+
+    vtrange(table, VT_GROUND, 0x20, 0x7E, VT_PRINT, VT_STAY);
+    vtrange(table, VT_GROUND, 0xA0, 0xFF, VT_PRINT, VT_STAY);
+
+    vtrange(table, VT_ESCAPE, 0x20, 0x2F, VT_COLLECT, VT_ESCAPE_INTERMEDIATE);
+    vtrange(table, VT_ESCAPE, 0x30, 0x7E, VT_ESC_DISPATCH, VT_GROUND);
+    vtrange(table, VT_ESCAPE, '[', '[', VT_IGNORE, VT_CSI_ENTRY);
+    vtrange(table, VT_ESCAPE, ']', ']', VT_IGNORE, VT_STR);
+    vtrange(table, VT_ESCAPE, 'P', 'P', VT_IGNORE, VT_STR);
+    vtrange(table, VT_ESCAPE, 'X', 'X', VT_IGNORE, VT_STR);
+    vtrange(table, VT_ESCAPE, '^', '_', VT_IGNORE, VT_STR);
+    vtrange(table, VT_ESCAPE, 'k', 'k', VT_IGNORE, VT_STR); /* old title set compatibility */
+
+    vtrange(table, VT_ESCAPE_INTERMEDIATE, 0x20, 0x2F, VT_COLLECT, VT_STAY);
+    vtrange(table, VT_ESCAPE_INTERMEDIATE, 0x30, 0x7E, VT_ESC_DISPATCH, VT_GROUND);
+
+    vtrange(table, VT_CSI_ENTRY, 0x20, 0x2F, VT_COLLECT, VT_CSI_INTERMEDIATE);
+    vtrange(table, VT_CSI_ENTRY, 0x30, 0x3B, VT_PARAM, VT_CSI_PARAM);
+    vtrange(table, VT_CSI_ENTRY, ':', ':', VT_IGNORE, VT_CSI_IGNORE);
+    vtrange(table, VT_CSI_ENTRY, 0x3C, 0x3F, VT_COLLECT, VT_CSI_PARAM);
+    vtrange(table, VT_CSI_ENTRY, 0x40, 0x7E, VT_CSI_DISPATCH, VT_GROUND);
+
+    vtrange(table, VT_CSI_PARAM, 0x20, 0x2F, VT_COLLECT, VT_CSI_INTERMEDIATE);
+    vtrange(table, VT_CSI_PARAM, 0x30, 0x3B, VT_PARAM, VT_STAY);
+    vtrange(table, VT_CSI_PARAM, ':', ':', VT_IGNORE, VT_CSI_IGNORE);
+    vtrange(table, VT_CSI_PARAM, 0x3C, 0x3F, VT_IGNORE, VT_CSI_IGNORE);
+    vtrange(table, VT_CSI_PARAM, 0x40, 0x7E, VT_CSI_DISPATCH, VT_GROUND);
+
+    vtrange(table, VT_CSI_INTERMEDIATE, 0x20, 0x2F, VT_COLLECT, VT_STAY);
+    vtrange(table, VT_CSI_INTERMEDIATE, 0x30, 0x3F, VT_IGNORE, VT_CSI_IGNORE);
+    vtrange(table, VT_CSI_INTERMEDIATE, 0x40, 0x7E, VT_CSI_DISPATCH, VT_GROUND);
+
+    vtrange(table, VT_CSI_IGNORE, 0x40, 0x7E, VT_IGNORE, VT_GROUND);
+
+    /* as in st, strings keep every character but their terminators, C0 controls included */
+    vtrange(table, VT_STR, 0x00, 0xFF, VT_STR_PUT, VT_STAY);
+    vtrange(table, VT_STR, '\a', '\a', VT_STR_DISPATCH, VT_GROUND);
+
+    /* transitions from anywhere */
+    for (s = 0; s < VT_STATE_COUNT; s++) {
+        vtrange(table, s, 0x18, 0x18, VT_EXECUTE, VT_GROUND); /* CAN */
+        vtrange(table, s, 0x1A, 0x1A, VT_EXECUTE, VT_GROUND); /* SUB */
+        vtrange(table, s, 0x1B, 0x1B, VT_IGNORE, VT_ESCAPE);
+        vtrange(table, s, 0x80, 0x9F, VT_EXECUTE, VT_GROUND);
+        vtrange(table, s, 0x90, 0x90, VT_IGNORE, VT_STR);       /* DCS */
+        vtrange(table, s, 0x98, 0x98, VT_IGNORE, VT_STR);       /* SOS */
+        vtrange(table, s, 0x9B, 0x9B, VT_IGNORE, VT_CSI_ENTRY); /* CSI */
+        vtrange(table, s, 0x9C, 0x9C, VT_IGNORE, VT_GROUND);    /* ST */
+        vtrange(table, s, 0x9D, 0x9F, VT_IGNORE, VT_STR);       /* OSC, PM, APC */
+    }
+    vtrange(table, VT_STR, 0x1B, 0x1B, VT_STR_END, VT_ESCAPE);
+    vtrange(table, VT_STR, 0x9C, 0x9C, VT_STR_DISPATCH, VT_GROUND);
+
+    return table;
+}
+
+static constexpr VTTable vttable = vtbuild();
+
+#endif // STPARSER_H
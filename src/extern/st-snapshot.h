@@ -0,0 +1,64 @@
+#ifndef STSNAPSHOT_H
+#define STSNAPSHOT_H
+
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+#include "st-utils.h"
+
+/*
+ * Immutable copy of the visible part of the terminal, as the view paints it.
+ * Glyphs are stored row after row, selected glyphs already have ATTR_REVERSE toggled.
+ */
+struct TermSnapshot {
+    int row = 0;
+    int col = 0;
+    int histi = 0;
+    int scr = 0;
+    TCursor c = {};
+    std::vector<Glyph> glyphs;
+    std::vector<uint64_t> versions; /* version of each row this snapshot holds */
+};
+
+/*
+ * Triple buffer handing snapshots from the thread parsing the tty to the GUI thread.
+ * The writer fills back() and publishes it by swapping it with the middle slot, the reader
+ * swaps its front slot with the middle one when a newer snapshot is there. Neither side
+ * ever waits for the other or touches a slot the other one owns.
+ */
+class TermSnapshots
+{
+public:
+    /* slot the writer fills, only valid on the writer's thread */
+    TermSnapshot &
+    back()
+    {
+        return buffers[backIndex];
+    }
+
+    void
+    publish()
+    {
+        backIndex = middle.exchange(backIndex | fresh, std::memory_order_acq_rel) & ~fresh;
+    }
+
+    /* newest published snapshot, only valid on the reader's thread */
+    const TermSnapshot &
+    acquire()
+    {
+        if (middle.load(std::memory_order_relaxed) & fresh)
+            frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & ~fresh;
+        return buffers[frontIndex];
+    }
+
+private:
+    static const int fresh = 4;
+
+    TermSnapshot buffers[3];
+    int backIndex = 0;
+    std::atomic<int> middle{ 1 };
+    int frontIndex = 2;
+};
+
+#endif // STSNAPSHOT_H
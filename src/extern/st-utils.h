@@ -127,16 +127,6 @@ enum charset {
     CS_FIN
 };
 
-enum escape_state {
-    ESC_START = 1,
-    ESC_CSI = 2,
-    ESC_STR = 4, /* DCS, OSC, PM, APC */
-    ESC_ALTCHARSET = 8,
-    ESC_STR_END = 16, /* a final string was encountered */
-    ESC_TEST = 32,    /* Enter in test mode */
-    ESC_UTF8 = 64,
-};
-
 typedef struct {
     int mode;
     int type;
@@ -173,7 +163,7 @@ typedef struct {
     int top;             /* top    scroll limit */
     int bot;             /* bottom scroll limit */
     int mode;            /* terminal mode flags */
-    int esc;             /* escape state flags */
+    int esc;             /* escape parser state */
     char trantbl[4];     /* charset table translation */
     int charset;         /* current charset */
     int icharset;        /* selected charset for sequence */
@@ -186,7 +176,8 @@ typedef struct {
 typedef struct {
     char buf[ESC_BUF_SIZ]; /* raw string */
     size_t len;            /* raw string length */
-    char priv;
+    char priv;  /* private marker */
+    char inter; /* intermediate character, -1 if there are more */
     int arg[ESC_ARG_SIZ];
     int narg; /* nb of args */
     char mode[2];
@@ -1,13 +1,21 @@
 #include "st.h"
+#include "st-parser.h"
 #include <stdio.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <pwd.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <poll.h>
+#include <fcntl.h>
 
 #include <QString>
 #include <QApplication>
+#include <QScreen>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #if   defined(__linux)
 #include <pty.h>
@@ -17,17 +25,59 @@
 #include <libutil.h>
 #endif
 
-SimpleTerminal::SimpleTerminal(QObject *parent) : QObject(parent) {
-    readBufSize = sizeof(readBuf) / sizeof(readBuf[0]);
+/*
+ * Length of the run of printable ASCII characters s starts with, 16 bytes at a time where
+ * SSE2 is available.
+ */
+static int asciirun(const char *s, int len) {
+    int n = 0;
+
+#ifdef __SSE2__
+    const __m128i below = _mm_set1_epi8(0x20 - 1);
+    const __m128i above = _mm_set1_epi8(0x7f);
+
+    /* compared as signed bytes, anything from 0x80 on is negative and never above 0x1f */
+    for (; n + 16 <= len; n += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (s + n));
+        __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmplt_epi8(v, above));
+        int mask = _mm_movemask_epi8(printable);
+        if (mask != 0xFFFF)
+            return n + __builtin_ctz(~mask);
+    }
+#endif
+    while (n < len && BETWEEN(s[n], 0x20, 0x7e))
+        n++;
+    return n;
+}
+
+SimpleTerminal::SimpleTerminal(QObject *parent) : QObject(parent), updateTimer(this) {
+    setReadBufferSize(64 * 1024);
+
+    QScreen *screen = QGuiApplication::primaryScreen();
+    if (screen && screen->refreshRate() > 0)
+        frameInterval = MAX(1, qRound(1000 / screen->refreshRate()));
+
+    updateTimer.setSingleShot(true);
+    connect(&updateTimer, &QTimer::timeout, this, [this]() {
+        publish();
+        lastUpdate.start();
+        emit s_updateView();
+    });
 
     tnew(80, 80);
     ttynew();
 
-    readNotifier = new QSocketNotifier(master, QSocketNotifier::Read);
+    readNotifier = new QSocketNotifier(master, QSocketNotifier::Read, this);
     readNotifier->setEnabled(true);
 
     connect(readNotifier, &QSocketNotifier::activated, this, &SimpleTerminal::ttyread);
 
+    /* only enabled while there is queued input the pty did not take */
+    writeNotifier = new QSocketNotifier(master, QSocketNotifier::Write, this);
+    writeNotifier->setEnabled(false);
+
+    connect(writeNotifier, &QSocketNotifier::activated, this, &SimpleTerminal::ttyflush);
+
     // Fix for Zorin OS (error: invalid old space)
     // Needed since we only call realloc later
     strescseq.buf = (char *) malloc(STR_BUF_SIZ);
@@ -44,8 +94,10 @@ SimpleTerminal::~SimpleTerminal() {
     free(term.dirty);
     free(term.tabs);
     free(strescseq.buf);
+    free(readBuf);
 
     delete readNotifier;
+    delete writeNotifier;
 }
 
 void SimpleTerminal::tnew(int col, int row) {
@@ -65,6 +117,11 @@ void SimpleTerminal::closePty() {
         master = -1;
     }
 
+    writeQueue.clear();
+    writeQueuePos = 0;
+    if (writeNotifier)
+        writeNotifier->setEnabled(false);
+
     emit s_closed();
 }
 
@@ -115,6 +172,8 @@ void SimpleTerminal::ttynew() {
             }
 #endif
             ::close(slave);
+            /* reads and writes return what the pty has or takes at once */
+            ::fcntl(master, F_SETFL, ::fcntl(master, F_GETFL) | O_NONBLOCK);
             break;
     }
 }
@@ -156,32 +215,122 @@ void SimpleTerminal::execsh() {
 }
 
 size_t SimpleTerminal::ttyread() {
-    int ret, written;
+    struct pollfd pfd = { master, POLLIN, 0 };
+    QElapsedTimer budget;
+    ssize_t ret;
+    size_t total = 0;
+    int written;
 
-    /* append read bytes to unprocessed bytes */
-    ret = ::read(master, readBuf + readBufPos, readBufSize - readBufPos);
+    /*
+     * Drain the pty until it runs dry or the budget is spent, parsing every read as it
+     * comes in. Whatever is left makes the notifier fire again on the next event loop
+     * iteration, so input and painting are not starved by a program flooding the tty.
+     */
+    budget.start();
+    for (;;) {
+        /* append read bytes to unprocessed bytes */
+        ret = ::read(master, readBuf + readBufPos, readBufSize - readBufPos);
 
-    switch (ret) {
-        case 0:
-            return 0;
-        case -1:
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (ret < 0) {
             closePty();
             emit s_error("Could not read from shell.");
             return 0;
-        default:
-            readBufPos += ret;
-            written = twrite(readBuf, readBufPos, 0);
-            readBufPos -= written;
-            /* keep any incomplete UTF-8 byte sequence for the next call */
-            if (readBufPos > 0) {
-                ::memmove(readBuf, readBuf + written, readBufPos);
-            }
+        }
+        if (ret == 0)
+            break;
 
-            emit s_updateView(&term);
-            return ret;
+        total += ret;
+        readBufPos += ret;
+        written = twrite(readBuf, readBufPos, 0);
+        readBufPos -= written;
+        /* keep any incomplete UTF-8 byte sequence for the next call */
+        if (readBufPos > 0) {
+            ::memmove(readBuf, readBuf + written, readBufPos);
+        }
+
+        if (budget.elapsed() >= readBudget || ::poll(&pfd, 1, 0) <= 0)
+            break;
+    }
+
+    if (total > 0)
+        scheduleUpdate();
+    return total;
+}
+
+void SimpleTerminal::scheduleUpdate(void) {
+    if (updateTimer.isActive())
+        return;
+
+    /* the first update after a pause is immediate, the ones following it wait for the frame */
+    qint64 since = lastUpdate.isValid() ? lastUpdate.elapsed() : frameInterval;
+    if (since >= frameInterval) {
+        publish();
+        lastUpdate.start();
+        emit s_updateView();
+    } else {
+        updateTimer.start(frameInterval - since);
     }
 }
 
+void SimpleTerminal::publish(void) {
+    TermSnapshot &snap = snapshots.back();
+    int x, y;
+
+    /*
+     * Rows are versioned from the dirty flags, a slot only copies the rows it holds an older
+     * version of. Scrolled back, the rows shown are not the screen lines the dirty flags
+     * refer to, so every row is taken as changed.
+     */
+    bool full = (int) rowVersions.size() != term.row || snap.col != term.col ||
+                term.scr != 0 || publishedScr != 0;
+    rowVersions.resize(term.row);
+    for (y = 0; y < term.row; y++) {
+        if (full || term.dirty[y])
+            rowVersions[y] = ++version;
+        term.dirty[y] = 0;
+    }
+    publishedScr = term.scr;
+
+    if (snap.row != term.row || snap.col != term.col) {
+        snap.row = term.row;
+        snap.col = term.col;
+        snap.glyphs.resize(term.row * term.col);
+        snap.versions.assign(term.row, 0);
+    }
+
+    for (y = 0; y < term.row; y++) {
+        if (snap.versions[y] == rowVersions[y])
+            continue;
+        Glyph *dst = snap.glyphs.data() + y * term.col;
+        memcpy(dst, TLINE(term, y), term.col * sizeof(Glyph));
+        for (x = 0; x < term.col; x++) {
+            if (selected(x, y))
+                dst[x].mode ^= ATTR_REVERSE;
+        }
+        snap.versions[y] = rowVersions[y];
+    }
+
+    snap.histi = term.histi;
+    snap.scr = term.scr;
+    snap.c = term.c;
+    snapshots.publish();
+}
+
+void SimpleTerminal::setReadBufferSize(size_t size) {
+    /* the buffer has to hold at least the incomplete UTF-8 sequence carried over */
+    readBufSize = MAX(size, (size_t) BUFSIZ);
+    readBuf = (char *) realloc(readBuf, readBufSize);
+    readBufPos = MIN(readBufPos, readBufSize);
+}
+
+void SimpleTerminal::setReadBudget(int msec) {
+    readBudget = MAX(msec, 0);
+}
+
 void SimpleTerminal::tresize(int col, int row) {
     int i, j;
     int minrow = MIN(row, term.row);
@@ -296,6 +445,7 @@ void SimpleTerminal::tputc(Rune u) {
     char c[UTF_SIZ];
     int control;
     int width, len;
+    uint8_t t;
     Glyph *gp;
 
     control = ISCONTROL(u);
@@ -312,94 +462,66 @@ void SimpleTerminal::tputc(Rune u) {
         tprinter(c, len);
     }
 
-
     /*
-     * STR sequence must be checked before anything else
-     * because it uses all following characters until it
-     * receives a ESC, a SUB, a ST or any other C1 control
-     * character.
+     * One lookup gives what to do with u in the current state and the state
+     * it leads to, entering a state may reset what it collects.
      */
-    if (term.esc & ESC_STR) {
-        if (u == '\a' || u == 030 || u == 032 || u == 033 ||
-            ISCONTROLC1(u)) {
-            term.esc &= ~(ESC_START | ESC_STR);
-            term.esc |= ESC_STR_END;
-            goto check_control_code;
+    t = vttable.t[term.esc][MIN(u, 0xFF)];
+    if (VT_STATE(t) != VT_STAY) {
+        term.esc = VT_STATE(t);
+        if (term.esc == VT_ESCAPE || term.esc == VT_CSI_ENTRY) {
+            csireset();
+            strpending = 0;
+        } else if (term.esc == VT_STR) {
+            tstrsequence(u);
         }
+    }
 
-        if (strescseq.len + len >= strescseq.siz) {
-            /*
-             * Here is a bug in terminals. If the user never sends
-             * some code to stop the str or esc command, then st
-             * will stop responding. But this is better than
-             * silently failing with unknown characters. At least
-             * then users will report back.
-             *
-             * In the case users ever get fixed, here is the code:
-             */
+    switch (VT_ACTION(t)) {
+        case VT_IGNORE:
+            return;
+        case VT_PRINT:
+            break;
+        case VT_EXECUTE:
             /*
-             * term.esc = 0;
-             * strhandle();
+             * Actions of control codes are performed as soon as they arrive,
+             * even inside a sequence. They are never shown.
              */
-            if (strescseq.siz > (SIZE_MAX - UTF_SIZ) / 2)
-                return;
-            strescseq.siz *= 2;
-            strescseq.buf = (char *) realloc(strescseq.buf, strescseq.siz);
-
-            if (strescseq.buf == NULL) {
-                emit s_error("Could not realloc buffer.");
-                return;
-            }
-        }
-
-        memmove(&strescseq.buf[strescseq.len], c, len);
-        strescseq.len += len;
-        return;
-    }
-
-    check_control_code:
-    /*
-     * Actions of control codes must be performed as soon they arrive
-     * because they can be embedded inside a control sequence, and
-     * they must not cause conflicts with sequences.
-     */
-    if (control) {
-        tcontrolcode(u);
-        /*
-         * control codes are not shown ever
-         */
-        if (!term.esc)
-            term.lastc = 0;
-        return;
-    } else if (term.esc & ESC_START) {
-        if (term.esc & ESC_CSI) {
-            csiescseq.buf[csiescseq.len++] = u;
-            if (BETWEEN(u, 0x40, 0x7E)
-                || csiescseq.len >= \
-                    sizeof(csiescseq.buf) - 1) {
-                term.esc = 0;
-                csiparse();
-                csihandle();
-            }
+            tcontrolcode(u);
+            if (term.esc == VT_GROUND)
+                term.lastc = 0;
+            return;
+        case VT_COLLECT:
+            csiappend(u);
+            if (BETWEEN(u, 0x3C, 0x3F))
+                csiescseq.priv = u;
+            else
+                csiescseq.inter = csiescseq.inter ? -1 : u;
+            return;
+        case VT_PARAM:
+            csiappend(u);
+            csiparam(u);
+            return;
+        case VT_ESC_DISPATCH:
+            eschandle(u);
+            strpending = 0;
+            return;
+        case VT_CSI_DISPATCH:
+            csiappend(u);
+            csidispatch(u);
+            return;
+        case VT_STR_PUT:
+            strput(c, len);
+            return;
+        case VT_STR_END:
+            /* the string is handled if the ESC is the start of ST */
+            strpending = 1;
+            return;
+        case VT_STR_DISPATCH:
+            strhandle();
             return;
-        } else if (term.esc & ESC_UTF8) {
-            tdefutf8(u);
-        } else if (term.esc & ESC_ALTCHARSET) {
-            tdeftran(u);
-        } else if (term.esc & ESC_TEST) {
-            tdectest(u);
-        } else {
-            if (!eschandle(u))
-                return;
-            /* sequence already finished */
-        }
-        term.esc = 0;
-        /*
-         * All characters which form part of a sequence are not
-         * printed
-         */
-        return;
     }
+
     if (selected(term.c.x, term.c.y))
         selclear();
 
@@ -439,12 +561,88 @@ void SimpleTerminal::tputc(Rune u) {
     }
 }
 
+/*
+ * Same as tputc for every character of s, which is printable ASCII only, filling
+ * the line up to the margin at once
+ */
+void SimpleTerminal::tputascii(const char *s, int len) {
+    Glyph *line;
+    int i, x, y, run;
+
+    while (len > 0) {
+        if (IS_SET(term.mode, MODE_WRAP) && (term.c.state & CURSOR_WRAPNEXT)) {
+            term.line[term.c.y][term.c.x].mode |= ATTR_WRAP;
+            tnewline(1);
+        }
+
+        /* without wrapping, the characters past the margin overwrite the last column */
+        x = term.c.x;
+        y = term.c.y;
+        run = MIN(len, term.col - x);
+        line = term.line[y];
+
+        if (sel.ob.x != -1) {
+            for (i = x; i < x + run; i++) {
+                if (selected(i, y)) {
+                    selclear();
+                    break;
+                }
+            }
+        }
+
+        /* the halves of wide characters the run overwrites only one of */
+        if (line[x].mode & ATTR_WDUMMY) {
+            line[x - 1].u = ' ';
+            line[x - 1].mode &= ~ATTR_WIDE;
+        }
+        if ((line[x + run - 1].mode & ATTR_WIDE) && x + run < term.col) {
+            line[x + run].u = ' ';
+            line[x + run].mode &= ~ATTR_WDUMMY;
+        }
+
+        for (i = 0; i < run; i++) {
+            line[x + i] = term.c.attr;
+            line[x + i].u = (uchar) s[i];
+        }
+        term.dirty[y] = 1;
+        term.lastc = (uchar) s[run - 1];
+
+        if (x + run < term.col) {
+            tmoveto(x + run, y);
+        } else {
+            tmoveto(term.col - 1, y);
+            term.c.state |= CURSOR_WRAPNEXT;
+        }
+        s += run;
+        len -= run;
+    }
+}
+
 int SimpleTerminal::twrite(const char *buf, int size, int show_ctrl) {
     int charsize;
     Rune u;
     int n;
 
     for (n = 0; n < size; n += charsize) {
+        /*
+         * Plain text outside of a sequence is written a run at a time. Whatever
+         * tputc would do differently for it, printing, inserting or translating
+         * through the graphic charset, takes the slow path. Inside a string,
+         * the same runs are all put into it at once.
+         */
+        if (term.esc == VT_GROUND &&
+            !IS_SET(term.mode, MODE_PRINT | MODE_INSERT) &&
+            term.trantbl[term.charset] != CS_GRAPHIC0 &&
+            (charsize = asciirun(buf + n, size - n)) > 0) {
+            tputascii(buf + n, charsize);
+            continue;
+        }
+        if (term.esc == VT_STR && !IS_SET(term.mode, MODE_PRINT) &&
+            (charsize = asciirun(buf + n, size - n)) > 0) {
+            strput(buf + n, charsize);
+            continue;
+        }
+
         if (IS_SET(term.mode, MODE_UTF8)) {
             /* process a complete utf8 char */
             charsize = utf8decode(buf + n, &u, size - n);
@@ -469,6 +667,25 @@ int SimpleTerminal::twrite(const char *buf, int size, int show_ctrl) {
     return n;
 }
 
+int SimpleTerminal::twritechars(const char *buf, int size) {
+    int charsize;
+    Rune u;
+    int n;
+
+    for (n = 0; n < size; n += charsize) {
+        if (IS_SET(term.mode, MODE_UTF8)) {
+            charsize = utf8decode(buf + n, &u, size - n);
+            if (charsize == 0)
+                break;
+        } else {
+            u = buf[n] & 0xFF;
+            charsize = 1;
+        }
+        tputc(u);
+    }
+    return n;
+}
+
 void SimpleTerminal::ttywrite(const char *s, size_t n, int may_echo) {
     const char *next;
 
@@ -498,59 +715,66 @@ void SimpleTerminal::ttywrite(const char *s, size_t n, int may_echo) {
 }
 
 void SimpleTerminal::ttywriteraw(const char *s, size_t n) {
-    fd_set wfd, rfd;
-    ssize_t r;
-    size_t lim = 256;
-
     /*
      * Remember that we are using a pty, which might be a modem line.
-     * Writing too much will clog the line. That's why we are doing this
-     * dance.
-     * FIXME: Migrate the world to Plan 9.
+     * Writing too much will clog the line. What the pty does not take
+     * right away is queued and written as it drains, the output the
+     * shell produces meanwhile is read from the event loop as usual.
      */
-    while (n > 0) {
-        FD_ZERO(&wfd);
-        FD_ZERO(&rfd);
-        FD_SET(master, &wfd);
-        FD_SET(master, &rfd);
-
-        /* Check if we can write. */
-        if (pselect(master + 1, &rfd, &wfd, NULL, NULL, NULL) < 0) {
-            if (errno == EINTR) {
+    writeQueue.append(s, n);
+    if (!writeNotifier->isEnabled())
+        ttyflush();
+}
+
+void SimpleTerminal::ttypaste(const char *s, size_t n) {
+    if (IS_SET(win.mode, MODE_BRCKTPASTE))
+        ttywrite("\033[200~", 6, 0);
+    ttywrite(s, n, 1);
+    if (IS_SET(win.mode, MODE_BRCKTPASTE))
+        ttywrite("\033[201~", 6, 0);
+}
+
+void SimpleTerminal::ttyflush(void) {
+    ssize_t r;
+    size_t n;
+
+    while (writeQueuePos < (size_t) writeQueue.size()) {
+        n = MIN(writeChunk, writeQueue.size() - writeQueuePos);
+        if ((r = ::write(master, writeQueue.constData() + writeQueuePos, n)) < 0) {
+            if (errno == EINTR)
                 continue;
-            }
-            emit s_error("Pselect failed in ttywriteraw");
-            return;
-        }
-        if (FD_ISSET(master, &wfd)) {
-            /*
-             * Only write the bytes written by ttywrite() or the
-             * default of 256. This seems to be a reasonable value
-             * for a serial line. Bigger values might clog the I/O.
-             */
-            if ((r = write(master, s, (n < lim) ? n : lim)) < 0) {
-                emit s_error("Error on write in ttywriteraw.");
-                return;
-            }
-            if (r < n) {
-                /*
-                 * We weren't able to write out everything.
-                 * This means the buffer is getting full
-                 * again. Empty it.
-                 */
-                if (n < lim)
-                    lim = ttyread();
-                n -= r;
-                s += r;
-            } else {
-                /* All bytes have been written. */
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                writeChunk = MAX(writeChunk / 2, minWriteChunk);
                 break;
             }
+            emit s_error("Error on write in ttywriteraw.");
+            writeQueue.clear();
+            writeQueuePos = 0;
+            break;
+        }
+        writeQueuePos += r;
+
+        /*
+         * A chunk taken whole lets the next one grow, one taken in part
+         * is what the pty holds, the rest waits until it can take more.
+         */
+        if ((size_t) r == n) {
+            writeChunk = MIN(writeChunk * 2, maxWriteChunk);
+        } else {
+            writeChunk = MAX((size_t) r, minWriteChunk);
+            break;
         }
-        if (FD_ISSET(master, &rfd))
-            lim = ttyread();
     }
-    return;
+
+    if (writeQueuePos == (size_t) writeQueue.size()) {
+        writeQueue.clear();
+        writeQueuePos = 0;
+    } else if (writeQueuePos > (size_t) writeQueue.size() / 2) {
+        writeQueue.remove(0, writeQueuePos);
+        writeQueuePos = 0;
+    }
+    if (writeNotifier)
+        writeNotifier->setEnabled(!writeQueue.isEmpty());
 }
 
 
@@ -634,17 +858,7 @@ void SimpleTerminal::tcontrolcode(uchar ascii) {
             tnewline(IS_SET(term.mode, MODE_CRLF));
             return;
         case '\a':   /* BEL */
-            if (term.esc & ESC_STR_END) {
-                /* backwards compatibility to xterm */
-                strhandle();
-            } else {
-                bell();
-            }
-            break;
-        case '\033': /* ESC */
-            csireset();
-            term.esc &= ~(ESC_CSI | ESC_ALTCHARSET | ESC_TEST);
-            term.esc |= ESC_START;
+            bell();
             return;
         case '\016': /* SO (LS1 -- Locking shift 1) */
         case '\017': /* SI (LS0 -- Locking shift 0) */
@@ -652,10 +866,9 @@ void SimpleTerminal::tcontrolcode(uchar ascii) {
             return;
         case '\032': /* SUB */
             tsetchar('?', &term.c.attr, term.c.x, term.c.y);
-            /* FALLTHROUGH */
+            return;
         case '\030': /* CAN */
-            csireset();
-            break;
+            return;
         case '\005': /* ENQ (IGNORED) */
         case '\000': /* NUL (IGNORED) */
         case '\021': /* XON (IGNORED) */
@@ -691,24 +904,13 @@ void SimpleTerminal::tcontrolcode(uchar ascii) {
         case 0x95:   /* TODO: MW */
         case 0x96:   /* TODO: SPA */
         case 0x97:   /* TODO: EPA */
-        case 0x98:   /* TODO: SOS */
         case 0x99:   /* TODO: SGCI */
             break;
         case 0x9a:   /* DECID -- Identify Terminal */
             ttywrite(vtiden, strlen(vtiden), 0);
             break;
-        case 0x9b:   /* TODO: CSI */
-        case 0x9c:   /* TODO: ST */
-            break;
-        case 0x90:   /* DCS -- Device Control String */
-        case 0x9d:   /* OSC -- Operating System Command */
-        case 0x9e:   /* PM -- Privacy Message */
-        case 0x9f:   /* APC -- Application Program Command */
-            tstrsequence(ascii);
-            return;
+        /* CSI, ST and the string introducers are transitions of the parser */
     }
-    /* only CAN, SUB, \a and C1 chars interrupt a sequence */
-    term.esc &= ~(ESC_STR_END | ESC_STR);
 }
 
 void SimpleTerminal::tputtab(int n) {
@@ -746,6 +948,9 @@ void SimpleTerminal::tstrsequence(uchar c) {
         case 0x90:   /* DCS -- Device Control String */
             c = 'P';
             break;
+        case 0x98:   /* SOS -- Start of String */
+            c = 'X';
+            break;
         case 0x9f:   /* APC -- Application Program Command */
             c = '_';
             break;
@@ -758,7 +963,31 @@ void SimpleTerminal::tstrsequence(uchar c) {
     }
     strreset();
     strescseq.type = c;
-    term.esc |= ESC_STR;
+    strpending = 0;
+}
+
+void SimpleTerminal::strput(const char *s, size_t len) {
+    while (strescseq.len + len >= strescseq.siz) {
+        /*
+         * Here is a bug in terminals. If the user never sends
+         * some code to stop the str or esc command, then st
+         * will stop responding. But this is better than
+         * silently failing with unknown characters. At least
+         * then users will report back.
+         */
+        if (strescseq.siz > (SIZE_MAX - UTF_SIZ) / 2)
+            return;
+        strescseq.siz *= 2;
+        strescseq.buf = (char *) realloc(strescseq.buf, strescseq.siz);
+
+        if (strescseq.buf == NULL) {
+            emit s_error("Could not realloc buffer.");
+            return;
+        }
+    }
+
+    memmove(&strescseq.buf[strescseq.len], s, len);
+    strescseq.len += len;
 }
 
 
@@ -886,7 +1115,7 @@ void SimpleTerminal::strhandle(void) {
     char *p = NULL, *dec;
     int j, narg, par;
 
-    term.esc &= ~(ESC_STR_END | ESC_STR);
+    strpending = 0;
     strparse();
     par = (narg = strescseq.narg) ? atoi(strescseq.args[0]) : 0;
 
@@ -976,6 +1205,7 @@ void SimpleTerminal::strhandle(void) {
         case 'k': /* old title set compatibility */
             return;
         case 'P': /* DCS -- Device Control String */
+        case 'X': /* SOS -- Start of String */
         case '_': /* APC -- Application Program Command */
         case '^': /* PM -- Privacy Message */
             return;
@@ -1068,32 +1298,47 @@ void SimpleTerminal::csireset(void) {
     memset(&csiescseq, 0, sizeof(csiescseq));
 }
 
-void SimpleTerminal::csiparse(void) {
-    char *p = csiescseq.buf, *np;
-    long int v;
+void SimpleTerminal::csiappend(uchar c) {
+    /* the raw sequence is only kept for csidump */
+    if (csiescseq.len < sizeof(csiescseq.buf) - 1)
+        csiescseq.buf[csiescseq.len++] = c;
+}
+
+void SimpleTerminal::csiparam(uchar c) {
+    int *arg;
+
+    if (csiescseq.narg == 0)
+        csiescseq.narg = 1;
+    if (c == ';') {
+        /* arguments past ESC_ARG_SIZ are dropped */
+        if (csiescseq.narg < ESC_ARG_SIZ)
+            csiescseq.arg[csiescseq.narg++] = 0;
+        return;
+    }
+    arg = &csiescseq.arg[csiescseq.narg - 1];
+    if (*arg >= 0)
+        *arg = (*arg > (INT_MAX - 9) / 10) ? -1 : *arg * 10 + (c - '0');
+}
 
-    csiescseq.narg = 0;
-    if (*p == '?') {
-        csiescseq.priv = 1;
-        p++;
+void SimpleTerminal::csidispatch(uchar final) {
+    /* only DEC private modes are implemented, as are single intermediates */
+    if ((csiescseq.priv && csiescseq.priv != '?') || csiescseq.inter == -1) {
+        fprintf(stderr, "erresc: unknown csi ");
+        csidump();
+        return;
     }
 
     csiescseq.buf[csiescseq.len] = '\0';
-    while (p < csiescseq.buf + csiescseq.len) {
-        np = NULL;
-        v = strtol(p, &np, 10);
-        if (np == p)
-            v = 0;
-        if (v == LONG_MAX || v == LONG_MIN)
-            v = -1;
-        csiescseq.arg[csiescseq.narg++] = v;
-        p = np;
-        if (*p != ';' || csiescseq.narg == ESC_ARG_SIZ)
-            break;
-        p++;
+    if (csiescseq.narg == 0)
+        csiescseq.narg = 1;
+    if (csiescseq.inter) {
+        csiescseq.mode[0] = csiescseq.inter;
+        csiescseq.mode[1] = final;
+    } else {
+        csiescseq.mode[0] = final;
+        csiescseq.mode[1] = '\0';
     }
-    csiescseq.mode[0] = *p++;
-    csiescseq.mode[1] = (p < csiescseq.buf + csiescseq.len) ? *p : '\0';
+    csihandle();
 }
 
 void SimpleTerminal::csihandle(void) {
@@ -1547,38 +1792,37 @@ void SimpleTerminal::tdeleteline(int n) {
 }
 
 /*
- * returns 1 when the sequence is finished and it hasn't to read
- * more characters for this sequence, otherwise 0
+ * handles the final character of an escape sequence, the intermediate
+ * character collected before it selects what it applies to
  */
-int SimpleTerminal::eschandle(uchar ascii) {
-    switch (ascii) {
-        case '[':
-            term.esc |= ESC_CSI;
-            return 0;
+void SimpleTerminal::eschandle(uchar ascii) {
+    switch (csiescseq.inter) {
+        case 0:
+            break;
+        case '(': /* GZD4 -- set primary charset G0 */
+        case ')': /* G1D4 -- set secondary charset G1 */
+        case '*': /* G2D4 -- set tertiary charset G2 */
+        case '+': /* G3D4 -- set quaternary charset G3 */
+            term.icharset = csiescseq.inter - '(';
+            tdeftran(ascii);
+            return;
         case '#':
-            term.esc |= ESC_TEST;
-            return 0;
+            tdectest(ascii);
+            return;
         case '%':
-            term.esc |= ESC_UTF8;
-            return 0;
-        case 'P': /* DCS -- Device Control String */
-        case '_': /* APC -- Application Program Command */
-        case '^': /* PM -- Privacy Message */
-        case ']': /* OSC -- Operating System Command */
-        case 'k': /* old title set compatibility */
-            tstrsequence(ascii);
-            return 0;
+            tdefutf8(ascii);
+            return;
+        default:
+            fprintf(stderr, "erresc: unknown sequence ESC 0x%02X '%c'\n",
+                    (uchar) ascii, isprint(ascii) ? ascii : '.');
+            return;
+    }
+
+    switch (ascii) {
         case 'n': /* LS2 -- Locking shift 2 */
         case 'o': /* LS3 -- Locking shift 3 */
             term.charset = 2 + (ascii - 'n');
             break;
-        case '(': /* GZD4 -- set primary charset G0 */
-        case ')': /* G1D4 -- set secondary charset G1 */
-        case '*': /* G2D4 -- set tertiary charset G2 */
-        case '+': /* G3D4 -- set quaternary charset G3 */
-            term.icharset = ascii - '(';
-            term.esc |= ESC_ALTCHARSET;
-            return 0;
         case 'D': /* IND -- Linefeed */
             if (term.c.y == term.bot) {
                 tscrollup(term.top, 1, 1);
@@ -1619,7 +1863,7 @@ int SimpleTerminal::eschandle(uchar ascii) {
             tcursor(CURSOR_LOAD);
             break;
         case '\\': /* ST -- String Terminator */
-            if (term.esc & ESC_STR_END)
+            if (strpending)
                 strhandle();
             break;
         default:
@@ -1627,7 +1871,6 @@ int SimpleTerminal::eschandle(uchar ascii) {
                     (uchar) ascii, isprint(ascii) ? ascii : '.');
             break;
     }
-    return 1;
 }
 
 void SimpleTerminal::treset(void) {
@@ -2178,7 +2421,8 @@ void SimpleTerminal::xsetmode(int set, unsigned int flags) {
 }
 
 void SimpleTerminal::bell() {
-    QApplication::beep();
+    /* QApplication::beep is only safe on the GUI thread */
+    emit s_bell();
 }
 
 void SimpleTerminal::ttyresize(int tw, int th) {
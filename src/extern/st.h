@@ -1,12 +1,16 @@
 #ifndef ST_H
 #define ST_H
 
+#include <QByteArray>
+#include <QElapsedTimer>
 #include <QObject>
 #include <QSocketNotifier>
 #include <QString>
+#include <QTimer>
 
 #include <sys/ioctl.h>
 
+#include "st-snapshot.h"
 #include "st-utils.h"
 
 class SimpleTerminal : public QObject
@@ -16,6 +20,12 @@ public:
     Term term;
     Selection sel;
 
+    /*
+     * Screen as last published for the view. The terminal lives on its own thread,
+     * the view reads nothing else of it.
+     */
+    TermSnapshots snapshots;
+
     SimpleTerminal(QObject *parent = nullptr);
 
     ~SimpleTerminal();
@@ -41,12 +51,32 @@ public:
     int
     twrite(const char *buf, int size, int show_ctrl);
 
+    /* twrite a code point at a time, the reference bench/TerminalBench.cpp checks it against */
+    int
+    twritechars(const char *buf, int size);
+
     void
     ttywrite(const char *s, size_t n, int may_echo);
 
     void
     ttywriteraw(const char *s, size_t n);
 
+    /* write pasted text, framed as a bracketed paste if the application asked for it */
+    void
+    ttypaste(const char *s, size_t n);
+
+    /* size of the buffer the pty is read into, at least BUFSIZ */
+    void
+    setReadBufferSize(size_t size);
+
+    /* milliseconds ttyread keeps draining the pty before returning to the event loop */
+    void
+    setReadBudget(int msec);
+
+    /* publish a snapshot and notify the view, at most once per frame */
+    void
+    scheduleUpdate(void);
+
     void
     kscrollup(int n);
 
@@ -81,6 +111,9 @@ public slots:
     size_t
     ttyread();
 
+    void
+    ttyflush(void);
+
 signals:
     void s_error(QString);
 
@@ -88,7 +121,10 @@ signals:
     s_closed();
 
     void
-    s_updateView(Term *state);
+    s_updateView();
+
+    void
+    s_bell();
 
 private:
     TermWindow win;
@@ -97,13 +133,33 @@ private:
     int master, slave;
     pid_t processId;
 
-    char readBuf[BUFSIZ];
-    int readBufPos = 0;
-    int readBufSize = 0;
+    char *readBuf = nullptr;
+    size_t readBufPos = 0;
+    size_t readBufSize = 0;
+    int readBudget = 8;
+
+    /* the view is updated at most once per frame, however often the pty is read */
+    int frameInterval = 16;
+    QElapsedTimer lastUpdate;
+    QTimer updateTimer;
+
+    /* version of each row of the screen, snapshot slots copy the rows they hold older ones of */
+    std::vector<uint64_t> rowVersions;
+    uint64_t version = 0;
+    int publishedScr = 0;
 
     QSocketNotifier *readNotifier;
+    QSocketNotifier *writeNotifier = nullptr;
+
+    /* input the pty did not take yet, written from writeQueuePos on */
+    QByteArray writeQueue;
+    size_t writeQueuePos = 0;
+    size_t writeChunk = 256;
+    static constexpr size_t minWriteChunk = 256;
+    static constexpr size_t maxWriteChunk = 64 * 1024;
     CSIEscape csiescseq;
     STREscape strescseq;
+    int strpending = 0; /* a string ended with ESC, ST completes it */
 
     /*
      * Default colors (colorname index)
@@ -143,9 +199,15 @@ private:
     char
     utf8encodebyte(Rune u, size_t i);
 
+    void
+    publish(void);
+
     void
     tputc(Rune u);
 
+    void
+    tputascii(const char *s, int len);
+
     void
     tcontrolcode(uchar ascii);
 
@@ -161,6 +223,9 @@ private:
     void
     strreset(void);
 
+    void
+    strput(const char *s, size_t len);
+
     void
     tclearregion(int x1, int y1, int x2, int y2);
 
@@ -183,7 +248,13 @@ private:
     csireset(void);
 
     void
-    csiparse(void);
+    csiappend(uchar c);
+
+    void
+    csiparam(uchar c);
+
+    void
+    csidispatch(uchar final);
 
     void
     csihandle(void);
@@ -242,7 +313,7 @@ private:
     void
     tdeleteline(int n);
 
-    int
+    void
     eschandle(uchar ascii);
 
     void
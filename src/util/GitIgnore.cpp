@@ -0,0 +1,181 @@
+#include "GitIgnore.hpp"
+
+namespace pico {
+
+namespace {
+
+constexpr size_t npos = std::string_view::npos;
+
+/* offset of the ']' closing the bracket expression at glob[start], npos if it is unterminated */
+size_t
+classEnd(std::string_view glob, size_t start)
+{
+    size_t i = start + 1;
+    if (i < glob.size() && (glob[i] == '!' || glob[i] == '^'))
+        i++;
+    /* a ']' right after the opening bracket is part of the class */
+    if (i < glob.size() && glob[i] == ']')
+        i++;
+    return glob.find(']', i);
+}
+
+/* whether c is in the class body, the text between the brackets */
+bool
+inClass(std::string_view body, char c)
+{
+    const bool negated = !body.empty() && (body[0] == '!' || body[0] == '^');
+    for (size_t i = negated ? 1 : 0; i < body.size(); i++) {
+        if (i + 2 < body.size() && body[i + 1] == '-') {
+            if (c >= body[i] && c <= body[i + 2])
+                return !negated;
+            i += 2;
+        } else if (body[i] == c) {
+            return !negated;
+        }
+    }
+    return negated;
+}
+
+} // namespace
+
+GitIgnore::GitIgnore(std::string base, std::shared_ptr<const GitIgnore> parent)
+    : m_base(std::move(base)),
+      m_parent(std::move(parent)),
+      m_rules()
+{}
+
+void
+GitIgnore::parse(std::string_view text)
+{
+    size_t pos = 0;
+    while (pos <= text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == npos)
+            end = text.size();
+        std::string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        /* trailing spaces are dropped unless escaped */
+        while (!line.empty() && line.back() == ' ' &&
+               !(line.size() >= 2 && line[line.size() - 2] == '\\'))
+            line.remove_suffix(1);
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        Rule rule{ {}, false, false, false };
+        if (line[0] == '!') {
+            rule.negated = true;
+            line.remove_prefix(1);
+        } else if (line[0] == '\\' && line.size() > 1 && (line[1] == '#' || line[1] == '!')) {
+            line.remove_prefix(1);
+        }
+        if (!line.empty() && line.back() == '/') {
+            rule.dirOnly = true;
+            line.remove_suffix(1);
+        }
+        if (line.empty())
+            continue;
+
+        rule.anchored = line.find('/') != npos;
+        if (line[0] == '/')
+            line.remove_prefix(1);
+        rule.glob = std::string(line);
+        m_rules.push_back(std::move(rule));
+    }
+}
+
+bool
+GitIgnore::empty(void) const
+{
+    return m_rules.empty();
+}
+
+bool
+GitIgnore::ignored(std::string_view path, bool isDir) const
+{
+    if (path.substr(0, m_base.size()) == m_base) {
+        const std::string_view relative = path.substr(m_base.size());
+        const size_t slash = relative.rfind('/');
+        const std::string_view name = slash == npos ? relative : relative.substr(slash + 1);
+
+        /* the last matching rule decides, rules here take precedence over the ones above */
+        for (auto it = m_rules.rbegin(); it != m_rules.rend(); ++it) {
+            if (it->dirOnly && !isDir)
+                continue;
+            if (match(it->glob, it->anchored ? relative : name))
+                return !it->negated;
+        }
+    }
+    return m_parent && m_parent->ignored(path, isDir);
+}
+
+bool
+GitIgnore::match(std::string_view glob, std::string_view text)
+{
+    size_t g = 0;
+    size_t t = 0;
+    while (g < glob.size()) {
+        const char c = glob[g];
+        if (c == '*') {
+            /* a ** component matches any number of directories */
+            const bool component = g + 1 < glob.size() && glob[g + 1] == '*' &&
+                                   (g == 0 || glob[g - 1] == '/') &&
+                                   (g + 2 == glob.size() || glob[g + 2] == '/');
+            if (component) {
+                if (g + 2 == glob.size())
+                    return true;
+                const std::string_view rest = glob.substr(g + 3);
+                for (size_t i = t;; i++) {
+                    if (match(rest, text.substr(i)))
+                        return true;
+                    i = text.find('/', i);
+                    if (i == npos)
+                        return false;
+                }
+            }
+
+            /* any other run of stars matches within one component */
+            while (g < glob.size() && glob[g] == '*')
+                g++;
+            const std::string_view rest = glob.substr(g);
+            for (size_t i = t;; i++) {
+                if (match(rest, text.substr(i)))
+                    return true;
+                if (i >= text.size() || text[i] == '/')
+                    return false;
+            }
+        }
+
+        if (t >= text.size())
+            return false;
+        if (c == '?') {
+            if (text[t] == '/')
+                return false;
+            g++;
+            t++;
+            continue;
+        }
+        if (c == '[') {
+            const size_t end = classEnd(glob, g);
+            /* an unterminated bracket is an ordinary character */
+            if (end != npos) {
+                if (text[t] == '/' || !inClass(glob.substr(g + 1, end - g - 1), text[t]))
+                    return false;
+                g = end + 1;
+                t++;
+                continue;
+            }
+        }
+        if (c == '\\' && g + 1 < glob.size())
+            g++;
+        if (glob[g] != text[t])
+            return false;
+        g++;
+        t++;
+    }
+    return t == text.size();
+}
+
+} // namespace pico
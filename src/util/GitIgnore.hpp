@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pico {
+
+/**
+ * Rules of one .gitignore file, chained to the rules of the directories above it
+ *
+ * Paths are relative to the root of the walk and use '/' as separator, directories are not
+ * descended into once ignored so a rule never has to look at the components above a path.
+ */
+class GitIgnore
+{
+public:
+    /* rules for the directory at base, e.g. "src/editor/", or "" for the root */
+    GitIgnore(std::string base, std::shared_ptr<const GitIgnore> parent);
+
+    /* add the rules in the text of a .gitignore file */
+    void
+    parse(std::string_view text);
+
+    bool
+    empty(void) const;
+
+    /* whether path is ignored by these rules or those of a directory above */
+    bool
+    ignored(std::string_view path, bool isDir) const;
+
+    /* whether text matches glob, * and ? stop at '/' while ** crosses it */
+    static bool
+    match(std::string_view glob, std::string_view text);
+
+private:
+    struct Rule {
+        std::string glob;
+        bool negated;
+        bool dirOnly;
+        /* a rule with a '/' other than a trailing one matches the whole path, not only the name */
+        bool anchored;
+    };
+
+    std::string m_base;
+    std::shared_ptr<const GitIgnore> m_parent;
+    std::vector<Rule> m_rules;
+};
+
+} // namespace pico
@@ -0,0 +1,340 @@
+#include "LineScanner.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PICO_SCANNER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PICO_TARGET_AVX2 __attribute__((target("avx2,popcnt,bmi")))
+#else
+#define PICO_TARGET_AVX2
+#endif
+
+namespace pico {
+
+namespace {
+
+using Result = LineScanner::Result;
+
+inline unsigned
+popcount(uint32_t mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return __popcnt(mask);
+#else
+    return __builtin_popcount(mask);
+#endif
+}
+
+inline unsigned
+ctz(uint32_t mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+/* position of the nth (1-based) set bit, mask must have at least n bits set */
+inline unsigned
+nthBit(uint32_t mask, size_t n)
+{
+    while (--n > 0)
+        mask &= mask - 1;
+    return ctz(mask);
+}
+
+/* scans byte by byte, prevCr carries a '\r' that ended the previous block */
+void
+scanScalar(const char *data, size_t size, Result &result, bool &prevCr)
+{
+    for (size_t i = 0; i < size; i++) {
+        const auto byte = static_cast<unsigned char>(data[i]);
+        if (byte == '\n') {
+            result.newlines++;
+            result.crlf += prevCr;
+        }
+        prevCr = byte == '\r';
+        result.codepoints += (byte & 0xC0) != 0x80;
+        result.supplementary += byte >= 0xF0;
+    }
+}
+
+Result
+scanScalar(const char *data, size_t size)
+{
+    Result result;
+    bool prevCr = false;
+    scanScalar(data, size, result, prevCr);
+    return result;
+}
+
+size_t
+findNthNewlineScalar(const char *data, size_t size, size_t n)
+{
+    const char *p = data;
+    const char *end = data + size;
+    while (p < end) {
+        p = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (!p)
+            break;
+        if (--n == 0)
+            return p - data;
+        p++;
+    }
+    return LineScanner::npos;
+}
+
+#ifdef PICO_SCANNER_X86
+
+/*
+ * The vector kernels count matches per byte lane by subtracting the all-ones compare results and
+ * fold the lanes with a sum of absolute differences before a lane can overflow, so the hot loop
+ * is compares and adds only. '\r' is rare outside of DOS files and only then are the masks
+ * pulled out to pair it with the '\n' in the next byte.
+ */
+
+constexpr size_t maxLaneBlocks = 255;
+
+inline size_t
+sumLanes(__m128i v)
+{
+    const __m128i sums = _mm_sad_epu8(v, _mm_setzero_si128());
+    return static_cast<size_t>(_mm_cvtsi128_si32(sums)) +
+           static_cast<size_t>(_mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums)));
+}
+
+Result
+scanSse2(const char *data, size_t size)
+{
+    Result result;
+    bool prevCr = false;
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriage = _mm_set1_epi8('\r');
+    /* signed compares, continuation bytes 0x80-0xBF are -128..-65, 4-byte leads are -16..-1 */
+    const __m128i lastContinuation = _mm_set1_epi8(-65);
+    const __m128i beforeLead4 = _mm_set1_epi8(-17);
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    while (size - i >= 16) {
+        __m128i newlines = zero, codepoints = zero, supplementary = zero;
+        const size_t blocks = std::min((size - i) / 16, maxLaneBlocks);
+        for (size_t b = 0; b < blocks; b++, i += 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            const __m128i isNewline = _mm_cmpeq_epi8(v, newline);
+            newlines = _mm_sub_epi8(newlines, isNewline);
+            codepoints = _mm_sub_epi8(codepoints, _mm_cmpgt_epi8(v, lastContinuation));
+            const __m128i lead4 =
+                _mm_and_si128(_mm_cmpgt_epi8(v, beforeLead4), _mm_cmplt_epi8(v, zero));
+            supplementary = _mm_sub_epi8(supplementary, lead4);
+
+            const uint32_t cr = _mm_movemask_epi8(_mm_cmpeq_epi8(v, carriage));
+            if (cr | prevCr) {
+                const uint32_t nl = _mm_movemask_epi8(isNewline);
+                result.crlf += popcount(((cr << 1) | prevCr) & nl);
+            }
+            prevCr = cr >> 15;
+        }
+        result.newlines += sumLanes(newlines);
+        result.codepoints += sumLanes(codepoints);
+        result.supplementary += sumLanes(supplementary);
+    }
+    scanScalar(data + i, size - i, result, prevCr);
+    return result;
+}
+
+size_t
+findNthNewlineSse2(const char *data, size_t size, size_t n)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t i = 0;
+    for (; size - i >= 16; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+        const unsigned count = popcount(mask);
+        if (n <= count)
+            return i + nthBit(mask, n);
+        n -= count;
+    }
+    const size_t offset = findNthNewlineScalar(data + i, size - i, n);
+    return offset == LineScanner::npos ? offset : i + offset;
+}
+
+PICO_TARGET_AVX2 inline size_t
+sumLanes(__m256i v)
+{
+    const __m256i sums = _mm256_sad_epu8(v, _mm256_setzero_si256());
+    const __m128i half =
+        _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    return static_cast<size_t>(_mm_cvtsi128_si32(half)) +
+           static_cast<size_t>(_mm_cvtsi128_si32(_mm_unpackhi_epi64(half, half)));
+}
+
+PICO_TARGET_AVX2 Result
+scanAvx2(const char *data, size_t size)
+{
+    Result result;
+    bool prevCr = false;
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i carriage = _mm256_set1_epi8('\r');
+    const __m256i lastContinuation = _mm256_set1_epi8(-65);
+    const __m256i beforeLead4 = _mm256_set1_epi8(-17);
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    while (size - i >= 32) {
+        __m256i newlines = zero, codepoints = zero, supplementary = zero;
+        const size_t blocks = std::min((size - i) / 32, maxLaneBlocks);
+        for (size_t b = 0; b < blocks; b++, i += 32) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            const __m256i isNewline = _mm256_cmpeq_epi8(v, newline);
+            newlines = _mm256_sub_epi8(newlines, isNewline);
+            codepoints = _mm256_sub_epi8(codepoints, _mm256_cmpgt_epi8(v, lastContinuation));
+            const __m256i lead4 =
+                _mm256_and_si256(_mm256_cmpgt_epi8(v, beforeLead4), _mm256_cmpgt_epi8(zero, v));
+            supplementary = _mm256_sub_epi8(supplementary, lead4);
+
+            const uint32_t cr = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, carriage));
+            if (cr | prevCr) {
+                const uint32_t nl = _mm256_movemask_epi8(isNewline);
+                result.crlf += popcount(((cr << 1) | prevCr) & nl);
+            }
+            prevCr = cr >> 31;
+        }
+        result.newlines += sumLanes(newlines);
+        result.codepoints += sumLanes(codepoints);
+        result.supplementary += sumLanes(supplementary);
+    }
+    scanScalar(data + i, size - i, result, prevCr);
+    return result;
+}
+
+PICO_TARGET_AVX2 size_t
+findNthNewlineAvx2(const char *data, size_t size, size_t n)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    for (; size - i >= 32; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        const uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+        const unsigned count = popcount(mask);
+        if (n <= count)
+            return i + nthBit(mask, n);
+        n -= count;
+    }
+    const size_t offset = findNthNewlineScalar(data + i, size - i, n);
+    return offset == LineScanner::npos ? offset : i + offset;
+}
+
+bool
+cpuHasAvx2(void)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt") &&
+           __builtin_cpu_supports("bmi");
+#else
+    /* leaf 7 ebx bit 5, and the OS must save the ymm registers (xgetbv bits 1 and 2) */
+    int info[4];
+    __cpuid(info, 1);
+    const bool osxsave = info[2] & (1 << 27);
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#endif
+}
+
+#endif // PICO_SCANNER_X86
+
+LineScanner::Isa
+detectIsa(void)
+{
+#ifdef PICO_SCANNER_X86
+    if (cpuHasAvx2())
+        return LineScanner::Isa::Avx2;
+    /* SSE2 is part of the x86-64 baseline */
+    return LineScanner::Isa::Sse2;
+#else
+    return LineScanner::Isa::Scalar;
+#endif
+}
+
+} // namespace
+
+LineScanner::Result
+LineScanner::scan(const char *data, size_t size)
+{
+    return scan(isa(), data, size);
+}
+
+size_t
+LineScanner::findNthNewline(const char *data, size_t size, size_t n)
+{
+    if (n == 0)
+        return npos;
+    switch (isa()) {
+#ifdef PICO_SCANNER_X86
+    case Isa::Avx2:
+        return findNthNewlineAvx2(data, size, n);
+    case Isa::Sse2:
+        return findNthNewlineSse2(data, size, n);
+#endif
+    default:
+        return findNthNewlineScalar(data, size, n);
+    }
+}
+
+LineScanner::Isa
+LineScanner::isa(void)
+{
+    static const Isa detected = detectIsa();
+    return detected;
+}
+
+bool
+LineScanner::supports(Isa isa)
+{
+    return isa <= LineScanner::isa();
+}
+
+const char *
+LineScanner::name(Isa isa)
+{
+    switch (isa) {
+    case Isa::Avx2:
+        return "avx2";
+    case Isa::Sse2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+LineScanner::Result
+LineScanner::scan(Isa isa, const char *data, size_t size)
+{
+    switch (isa) {
+#ifdef PICO_SCANNER_X86
+    case Isa::Avx2:
+        return scanAvx2(data, size);
+    case Isa::Sse2:
+        return scanSse2(data, size);
+#endif
+    default:
+        return scanScalar(data, size);
+    }
+}
+
+} // namespace pico
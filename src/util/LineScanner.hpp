@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+
+namespace pico {
+
+/**
+ * Vectorized single pass over UTF-8 text counting lines and codepoints
+ *
+ * The widest instruction set the CPU supports is picked at runtime, AVX2 or SSE2 on x86-64 with a
+ * scalar fallback everywhere else.
+ */
+class LineScanner
+{
+public: /* types */
+    enum class Isa {
+        Scalar,
+        Sse2,
+        Avx2,
+    };
+
+    struct Result {
+        size_t newlines = 0;
+        /* '\r\n' pairs, a subset of newlines */
+        size_t crlf = 0;
+        /* bytes that are not UTF-8 continuation bytes */
+        size_t codepoints = 0;
+        /* lead bytes of 4-byte sequences, which take two UTF-16 code units */
+        size_t supplementary = 0;
+    };
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+public: /* functions */
+    static Result
+    scan(const char *data, size_t size);
+
+    /* offset of the nth (1-based) '\n' in data, npos if there are fewer */
+    static size_t
+    findNthNewline(const char *data, size_t size, size_t n);
+
+    /* the instruction set scan and findNthNewline dispatch to */
+    static Isa
+    isa(void);
+
+    static bool
+    supports(Isa isa);
+
+    static const char *
+    name(Isa isa);
+
+    /* scan with a specific instruction set, which must be supported, used for benchmarking */
+    static Result
+    scan(Isa isa, const char *data, size_t size);
+};
+
+} // namespace pico
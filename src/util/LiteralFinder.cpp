@@ -0,0 +1,145 @@
+#include "LiteralFinder.hpp"
+#include "util/LineScanner.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PICO_FINDER_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PICO_TARGET_AVX2 __attribute__((target("avx2,bmi")))
+#else
+#define PICO_TARGET_AVX2
+#endif
+
+namespace pico {
+
+namespace {
+
+inline unsigned
+ctz(uint32_t mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+size_t
+findScalar(const char *data, size_t size, const std::string &needle)
+{
+    const size_t found = std::string_view(data, size).find(needle);
+    return found == std::string_view::npos ? LiteralFinder::npos : found;
+}
+
+#ifdef PICO_FINDER_X86
+
+/* compares the candidates in mask in full, bit k stands for a match starting at i + k */
+template<typename Mask>
+inline size_t
+verify(const char *data, size_t i, Mask mask, const std::string &needle)
+{
+    while (mask) {
+        const size_t pos = i + ctz(mask);
+        if (std::memcmp(data + pos + 1, needle.data() + 1, needle.size() - 2) == 0)
+            return pos;
+        mask &= mask - 1;
+    }
+    return LiteralFinder::npos;
+}
+
+size_t
+findSse2(const char *data, size_t size, const std::string &needle)
+{
+    const size_t last = needle.size() - 1;
+    const __m128i first = _mm_set1_epi8(needle.front());
+    const __m128i tail = _mm_set1_epi8(needle.back());
+
+    size_t i = 0;
+    for (; i + last + 16 <= size; i += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + last));
+        const uint32_t mask =
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, tail)));
+        const size_t found = verify(data, i, mask, needle);
+        if (found != LiteralFinder::npos)
+            return found;
+    }
+    const size_t found = findScalar(data + i, size - i, needle);
+    return found == LiteralFinder::npos ? found : i + found;
+}
+
+PICO_TARGET_AVX2 size_t
+findAvx2(const char *data, size_t size, const std::string &needle)
+{
+    const size_t last = needle.size() - 1;
+    const __m256i first = _mm256_set1_epi8(needle.front());
+    const __m256i tail = _mm256_set1_epi8(needle.back());
+
+    size_t i = 0;
+    for (; i + last + 32 <= size; i += 32) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + last));
+        const uint32_t mask = _mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, tail)));
+        const size_t found = verify(data, i, mask, needle);
+        if (found != LiteralFinder::npos)
+            return found;
+    }
+    const size_t found = findScalar(data + i, size - i, needle);
+    return found == LiteralFinder::npos ? found : i + found;
+}
+
+#endif // PICO_FINDER_X86
+
+} // namespace
+
+LiteralFinder::LiteralFinder(std::string needle)
+    : m_needle(std::move(needle))
+{}
+
+size_t
+LiteralFinder::find(const char *data, size_t size) const
+{
+    if (m_needle.empty())
+        return 0;
+    if (m_needle.size() > size)
+        return npos;
+    /* memchr is already vectorized and has no false candidates to verify */
+    if (m_needle.size() == 1) {
+        const void *found = std::memchr(data, m_needle.front(), size);
+        return found ? static_cast<const char *>(found) - data : npos;
+    }
+
+    switch (LineScanner::isa()) {
+#ifdef PICO_FINDER_X86
+    case LineScanner::Isa::Avx2:
+        return findAvx2(data, size, m_needle);
+    case LineScanner::Isa::Sse2:
+        return findSse2(data, size, m_needle);
+#endif
+    default:
+        return findScalar(data, size, m_needle);
+    }
+}
+
+const std::string &
+LiteralFinder::needle(void) const
+{
+    return m_needle;
+}
+
+bool
+LiteralFinder::empty(void) const
+{
+    return m_needle.empty();
+}
+
+} // namespace pico
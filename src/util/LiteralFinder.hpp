@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace pico {
+
+/**
+ * Vectorized substring search, candidates are positions where both the first and the last byte of
+ * the needle match and only those are compared in full
+ *
+ * Dispatches to the same instruction set as LineScanner.
+ */
+class LiteralFinder
+{
+public:
+    explicit LiteralFinder(std::string needle);
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    /* offset of the first occurrence of the needle in data, npos if there is none */
+    size_t
+    find(const char *data, size_t size) const;
+
+    const std::string &
+    needle(void) const;
+
+    bool
+    empty(void) const;
+
+private:
+    std::string m_needle;
+};
+
+} // namespace pico